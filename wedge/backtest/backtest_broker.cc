@@ -3,32 +3,23 @@
 namespace wedge {
 
 OrderIndex BacktestBroker::limit_buy_order(double quantity, double price) {
-  int index = context_->add_order(wedge::limit_buy_order(quantity, price));
-  context_->logger_->trace("{}th LBO quantity {} price {}", index, quantity,
-                           price);
-  return OrderIndex(index);
+  return context_->add_order(LimitBuyOrder{quantity, price});
 }
 
 OrderIndex BacktestBroker::limit_sell_order(double quantity, double price) {
-  int index = context_->add_order(wedge::limit_sell_order(quantity, price));
-  context_->logger_->trace("{}th LSO quantity {} price {}", index, quantity,
-                           price);
-  return OrderIndex(index);
+  return context_->add_order(LimitSellOrder{quantity, price});
 }
 
 OrderIndex BacktestBroker::market_buy_order(double quantity) {
-  int index = context_->add_order(wedge::market_buy_order(quantity));
-  return OrderIndex(index);
+  return context_->add_order(MarketBuyOrder{quantity});
 }
 
 OrderIndex BacktestBroker::market_sell_order(double quantity) {
-  int index = context_->add_order(wedge::market_sell_order(quantity));
-  return OrderIndex(index);
+  return context_->add_order(MarketSellOrder{quantity});
 }
 
 void BacktestBroker::cancel(OrderIndex order_index) {
-  context_->cancel(order_index.index());
-  context_->logger_->trace("cacel {}th order", order_index.index());
+  context_->cancel(order_index);
 }
 
 Account BacktestBroker::account() { return context_->account(); }
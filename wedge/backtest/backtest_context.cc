@@ -1,13 +1,9 @@
 #include "wedge/backtest/backtest_context.h"
 
-#include <fmt/chrono.h>
-
-#include <cassert>
-#include <cstdio>
+#include <algorithm>
 #include <optional>
 
 #include "wedge/backtest/backtest_broker.h"
-#include "wedge/dataset/sql_iterator.h"
 
 namespace wedge {
 
@@ -15,72 +11,147 @@ std::unique_ptr<IBroker> BacktestContext::broker() {
   return std::make_unique<BacktestBroker>(this);
 }
 
-int BacktestContext::add_order(std::unique_ptr<IOrder> order) {
-  int index = last_order_index_++;
-  orders_.emplace(index, std::move(order));
-  return index;
+template <class Compare>
+static void insert_level(std::vector<std::pair<double, int>>& book,
+                         std::pair<double, int> level, Compare compare) {
+  book.insert(std::upper_bound(book.begin(), book.end(), level, compare),
+              level);
 }
 
-static std::string convert_unix_timestamp_ms(int64_t timestamp_ms) {
-  std::chrono::milliseconds ms(timestamp_ms);
-  std::chrono::seconds s = std::chrono::duration_cast<std::chrono::seconds>(ms);
-  std::time_t time_t_value = s.count();
-  std::tm* tm = std::localtime(&time_t_value);
-  return fmt::format("{:%Y-%m-%d %H:%M:%S}", *tm);
+template <class Compare>
+static void erase_level(std::vector<std::pair<double, int>>& book,
+                        std::pair<double, int> level, Compare compare) {
+  auto iterator = std::lower_bound(book.begin(), book.end(), level, compare);
+  if (iterator != book.end() && *iterator == level) {
+    book.erase(iterator);
+  }
 }
 
-void BacktestContext::update_orders(const Candle& candle) {
-  bool should_log = false;
-  auto iterator = orders_.begin();
-  int last_index = last_order_index_;
-  while (iterator != orders_.end() && iterator->first < last_index) {
-    OrderIndex order_index{iterator->first};
-    std::unique_ptr<IOrder>& order = iterator->second;
-    if (!order->update(*this, candle)) {
-      ++iterator;
-    } else {
-      strategy_->on_order_filled(order_index);
-      iterator = orders_.erase(iterator);
-      should_log = true;
-    }
+OrderIndex BacktestContext::add_order(const Order& order) {
+  int slot;
+  if (free_slots_.empty()) {
+    slot = static_cast<int>(slots_.size());
+    slots_.emplace_back();
+  } else {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
   }
-  if (!should_log) return;
-  logger_->info(
-      "{} balance {:.4f} value {:.4f} price {:.4f} position {:.4f}e-5",
-      convert_unix_timestamp_ms(candle.close_time), account_.balance(),
-      account_.balance() + account_.position() * candle.close_price,
-      candle.close_price, account_.position() * 1e5);
+  OrderSlot& entry = slots_[slot];
+  entry.order = order;
+  entry.sequence = last_sequence_++;
+  entry.active = true;
+
+  auto price = order_price(order);
+  if (journal_) {
+    journal_->append(JournalRecord{
+        .time = current_time_,
+        .quantity = order_quantity(order),
+        .price = price.value_or(0),
+        .order = entry.sequence,
+        .event = JournalEvent::kPlace,
+        .buy = order_side(order) == OrderSide::kBuy,
+        .market = !price,
+    });
+  }
+  if (!price) {
+    market_orders_.push_back(slot);
+  } else if (order_side(order) == OrderSide::kBuy) {
+    insert_level(buy_limits_, {*price, slot}, std::greater<>());
+  } else {
+    insert_level(sell_limits_, {*price, slot}, std::less<>());
+  }
+  return OrderIndex(slot, entry.generation);
 }
 
-static Candle merge(const Candle& previous, const Candle& current) {
-  if (previous.volume == 0) {
-    return current;
-  }
-  if (current.volume == 0) {
-    return previous;
-  }
-
-  assert(previous.close_time == current.open_time);
-
-  Candle result;
-  result.open_time = previous.open_time;
-  result.close_time = current.close_time;
-  result.open_price = previous.open_price;
-  result.close_price = previous.close_price;
-  result.high_price = std::max(previous.high_price, current.high_price);
-  result.low_price = std::min(previous.low_price, current.low_price);
-  result.volume = previous.volume + current.volume;
-  result.quote_volume = previous.quote_volume + current.quote_volume;
-  result.traders = previous.traders + current.traders;
-  result.taker_buy_base = previous.taker_buy_base + current.taker_buy_base;
-  result.taker_buy_quote = previous.taker_buy_quote + current.taker_buy_quote;
-  return result;
+void BacktestContext::cancel(OrderIndex index) {
+  int slot = index.index();
+  if (slot < 0 || slot >= std::ssize(slots_)) {
+    return;
+  }
+  const OrderSlot& entry = slots_[slot];
+  if (!entry.active || entry.generation != index.generation()) {
+    return;
+  }
+  remove_order(slot);
+  if (journal_) {
+    journal_->append(JournalRecord{
+        .time = current_time_,
+        .order = entry.sequence,
+        .event = JournalEvent::kCancel,
+    });
+  }
 }
 
-void BacktestContext::run(SqlIterator data_loader) {
-  while (auto iterator = data_loader.next()) {
-    update_orders(*iterator);
-    strategy_->update(*iterator);
+void BacktestContext::remove_order(int slot) {
+  OrderSlot& entry = slots_[slot];
+  if (auto price = order_price(entry.order); !price) {
+    std::erase(market_orders_, slot);
+  } else if (order_side(entry.order) == OrderSide::kBuy) {
+    erase_level(buy_limits_, {*price, slot}, std::greater<>());
+  } else {
+    erase_level(sell_limits_, {*price, slot}, std::less<>());
+  }
+  entry.active = false;
+  entry.generation++;
+  free_slots_.push_back(slot);
+}
+
+void BacktestContext::update_orders(const Candle& candle) {
+  current_time_ = candle.close_time;
+  triggered_.clear();
+  for (auto [price, slot] : buy_limits_) {
+    if (price < candle.low_price) break;
+    triggered_.emplace_back(slots_[slot].sequence, slot);
+  }
+  for (auto [price, slot] : sell_limits_) {
+    if (price > candle.high_price) break;
+    triggered_.emplace_back(slots_[slot].sequence, slot);
+  }
+  for (int slot : market_orders_) {
+    triggered_.emplace_back(slots_[slot].sequence, slot);
+  }
+  // Fill in placement order, the same order a scan over all orders used.
+  std::sort(triggered_.begin(), triggered_.end());
+
+  bool filled_any = false;
+  for (auto [sequence, slot] : triggered_) {
+    // An earlier fill callback may have canceled this order, or a new order
+    // placed during this candle may have taken over its slot.
+    const OrderSlot& entry = slots_[slot];
+    if (!entry.active || entry.sequence != sequence) {
+      continue;
+    }
+    bool filled = std::visit(
+        [&](const auto& order) { return order.update(*this, candle); },
+        entry.order);
+    if (!filled) {
+      continue;
+    }
+    if (journal_) {
+      journal_->append(JournalRecord{
+          .time = current_time_,
+          .quantity = order_quantity(entry.order),
+          .price = order_price(entry.order).value_or(candle.close_price),
+          .balance = account_.balance(),
+          .position = account_.position(),
+          .order = sequence,
+          .event = JournalEvent::kFill,
+          .buy = order_side(entry.order) == OrderSide::kBuy,
+      });
+    }
+    OrderIndex index(slot, entry.generation);
+    remove_order(slot);
+    strategy_->on_order_filled(index);
+    filled_any = true;
+  }
+  if (filled_any && journal_) {
+    journal_->append(JournalRecord{
+        .time = current_time_,
+        .price = candle.close_price,
+        .balance = account_.balance(),
+        .position = account_.position(),
+        .event = JournalEvent::kEquity,
+    });
   }
 }
 
@@ -91,7 +162,7 @@ bool BacktestContext::execute_buy_order(double quantity, double price) {
   }
   account_.update_balance(-total_cost);
   account_.update_position(quantity * (1 - commission_));
-  logger_->info("buy order cost {:.4f} with price {:.4f}", -total_cost, price);
+  stats_.on_fill(OrderSide::kBuy, total_cost, total_cost * commission_);
   return true;
 }
 
@@ -102,9 +173,96 @@ bool BacktestContext::execute_sell_order(double quantity, double price) {
   double total_income = quantity * price;
   account_.update_balance(total_income * (1 - commission_));
   account_.update_position(-quantity);
-  logger_->info("sell order income {:.4f} with price {:.4f}", total_income,
-                price);
+  stats_.on_fill(OrderSide::kSell, total_income, total_income * commission_);
   return true;
 }
 
+static nlohmann::json order_to_json(const Order& order) {
+  return {
+      {"type", order.index()},
+      {"quantity", order_quantity(order)},
+      {"price", order_price(order).value_or(0)},
+  };
+}
+
+static Order order_from_json(const nlohmann::json& json) {
+  double quantity = json["quantity"];
+  double price = json["price"];
+  switch (json["type"].get<size_t>()) {
+    case 0:
+      return LimitBuyOrder{quantity, price};
+    case 1:
+      return LimitSellOrder{quantity, price};
+    case 2:
+      return MarketBuyOrder{quantity};
+    default:
+      return MarketSellOrder{quantity};
+  }
+}
+
+void BacktestContext::checkpoint(nlohmann::json& json) const {
+  json["time"] = current_time_;
+  json["balance"] = account_.balance();
+  json["position"] = account_.position();
+  json["last_sequence"] = last_sequence_;
+  json["free_slots"] = free_slots_;
+  nlohmann::json& slots = json["slots"] = nlohmann::json::array();
+  for (const OrderSlot& slot : slots_) {
+    slots.push_back({
+        {"order", order_to_json(slot.order)},
+        {"sequence", slot.sequence},
+        {"generation", slot.generation},
+        {"active", slot.active},
+    });
+  }
+  json["stats"] = stats_;
+  strategy_->to_json(json["strategy"]);
+}
+
+void BacktestContext::restore(const nlohmann::json& json) {
+  current_time_ = json["time"];
+  account_ = Account(json["balance"], json["position"]);
+  last_sequence_ = json["last_sequence"];
+  free_slots_ = json["free_slots"].get<std::vector<int>>();
+  slots_.clear();
+  buy_limits_.clear();
+  sell_limits_.clear();
+  market_orders_.clear();
+  for (const nlohmann::json& slot_json : json["slots"]) {
+    int slot = static_cast<int>(slots_.size());
+    OrderSlot& entry = slots_.emplace_back();
+    entry.order = order_from_json(slot_json["order"]);
+    entry.sequence = slot_json["sequence"];
+    entry.generation = slot_json["generation"];
+    entry.active = slot_json["active"];
+    if (!entry.active) {
+      continue;
+    }
+    if (auto price = order_price(entry.order); !price) {
+      market_orders_.push_back(slot);
+    } else if (order_side(entry.order) == OrderSide::kBuy) {
+      insert_level(buy_limits_, {*price, slot}, std::greater<>());
+    } else {
+      insert_level(sell_limits_, {*price, slot}, std::less<>());
+    }
+  }
+  std::sort(market_orders_.begin(), market_orders_.end());
+  stats_ = json["stats"].get<PerformanceStats>();
+  strategy_->from_json(json["strategy"]);
+}
+
+void BacktestContext::take_checkpoint(const Candle& candle) {
+  // The first boundary is the end of the window the first candle opens in.
+  if (next_checkpoint_ == 0) {
+    next_checkpoint_ =
+        (candle.open_time / checkpoint_interval_ + 1) * checkpoint_interval_;
+  }
+  if (candle.close_time + 1 < next_checkpoint_) {
+    return;
+  }
+  checkpoint_callback_(candle.close_time);
+  next_checkpoint_ = ((candle.close_time + 1) / checkpoint_interval_ + 1) *
+                     checkpoint_interval_;
+}
+
 }  // namespace wedge
\ No newline at end of file
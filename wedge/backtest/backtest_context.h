@@ -1,49 +1,120 @@
 #pragma once
 
-#include <spdlog/spdlog.h>
+#include <nlohmann/json.hpp>
 
-#include <map>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <span>
+#include <utility>
+#include <vector>
 
+#include "wedge/backtest/journal.h"
 #include "wedge/backtest/order/order.h"
-#include "wedge/dataset/sql_iterator.h"
+#include "wedge/common/performance_stats.h"
 #include "wedge/strategy/broker.h"
 #include "wedge/strategy/strategy.h"
 
 namespace wedge {
 
 class BacktestContext {
+  static constexpr size_t kBatchSize = 1024;
+
  public:
   BacktestContext(double balance, double position, double commission = 0)
       : account_(balance, position), commission_(commission) {}
 
-  void run(SqlIterator data_loader);
+  template <class DataLoader>
+  void run(DataLoader data_loader) {
+    std::vector<Candle> buffer(kBatchSize);
+    while (size_t count = data_loader.next_batch(buffer)) {
+      run(std::span<const Candle>(buffer).first(count));
+    }
+  }
+
+  void run(std::span<const Candle> candles) {
+    for (const Candle& candle : candles) {
+      update_orders(candle);
+      strategy_->update(candle);
+      stats_.on_candle(candle.close_time,
+                       account_.balance() +
+                           account_.position() * candle.close_price);
+      if (checkpoint_interval_ > 0 &&
+          candle.close_time + 1 >= next_checkpoint_) {
+        take_checkpoint(candle);
+      }
+    }
+  }
+
+  // Account, orders, statistics and strategy state. Restoring into a context
+  // built with the same strategy continues exactly where the run stopped.
+  void checkpoint(nlohmann::json& json) const;
+  void restore(const nlohmann::json& json);
+
+  // Calls `callback` with the close time of the last candle in every
+  // `interval_ms` window, right after that candle has been processed.
+  void set_checkpoint(int64_t interval_ms,
+                      std::function<void(int64_t)> callback) {
+    checkpoint_interval_ = interval_ms;
+    checkpoint_callback_ = std::move(callback);
+  }
+
   std::unique_ptr<IBroker> broker();
 
   bool execute_buy_order(double quantity, double price);
   bool execute_sell_order(double quantity, double price);
 
-  void set_logger(std::shared_ptr<spdlog::logger> logger) { logger_ = logger; }
+  // Optional, events are only recorded while a journal is set.
+  void set_journal(Journal* journal) { journal_ = journal; }
 
   void set_strategy(std::unique_ptr<IStrategy> strategy) {
     strategy_ = std::move(strategy);
   }
   Account& account() { return account_; }
+  PerformanceStats& stats() { return stats_; }
 
  private:
+  struct OrderSlot {
+    Order order;
+    // Placement sequence, fills within a candle happen in this order.
+    uint64_t sequence;
+    uint32_t generation = 0;
+    bool active = false;
+  };
+
+  using PriceLevel = std::pair<double, int>;
+
   void update_orders(const Candle& candle);
-  int add_order(std::unique_ptr<IOrder> order);
-  void cancel(int index) { orders_.erase(index); }
+  OrderIndex add_order(const Order& order);
+  void cancel(OrderIndex index);
+  void remove_order(int slot);
+  void take_checkpoint(const Candle& candle);
 
   friend class BacktestBroker;
 
   Account account_;
   std::unique_ptr<IStrategy> strategy_;
-  std::map<int, std::unique_ptr<IOrder>> orders_;
-  int last_order_index_ = 0;
+  // Orders live by value in reused slots, so placing and filling orders does
+  // not allocate once the vectors have grown to the working set.
+  std::vector<OrderSlot> slots_;
+  std::vector<int> free_slots_;
+  // Resting limits as sorted (price, slot) vectors, buys with the highest
+  // price and sells with the lowest price first, so a candle only walks the
+  // orders its range crosses.
+  std::vector<PriceLevel> buy_limits_;
+  std::vector<PriceLevel> sell_limits_;
+  std::vector<int> market_orders_;
+  std::vector<std::pair<uint64_t, int>> triggered_;
+  uint64_t last_sequence_ = 0;
   double commission_;
+  int64_t current_time_ = 0;
+  PerformanceStats stats_;
+
+  Journal* journal_ = nullptr;
 
-  std::shared_ptr<spdlog::logger> logger_;
+  int64_t checkpoint_interval_ = 0;
+  int64_t next_checkpoint_ = 0;
+  std::function<void(int64_t)> checkpoint_callback_;
 };
 
 }  // namespace wedge
\ No newline at end of file
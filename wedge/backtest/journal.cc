@@ -0,0 +1,50 @@
+#include "wedge/backtest/journal.h"
+
+#include <stdexcept>
+
+namespace wedge {
+
+Journal::Journal(const std::string& path, size_t capacity)
+    : file_(path, std::ios::binary | std::ios::trunc), buffer_(capacity) {
+  if (!file_) {
+    throw std::runtime_error("cannot create " + path);
+  }
+  JournalHeader header{
+      .magic = kJournalMagic,
+      .version = kJournalVersion,
+      .record_size = sizeof(JournalRecord),
+  };
+  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+Journal::~Journal() { flush(); }
+
+void Journal::flush() {
+  file_.write(reinterpret_cast<const char*>(buffer_.data()),
+              size_ * sizeof(JournalRecord));
+  file_.flush();
+  size_ = 0;
+}
+
+std::vector<JournalRecord> read_journal(const std::string& path) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    throw std::runtime_error("cannot open " + path);
+  }
+  size_t size = file.tellg();
+  file.seekg(0);
+  JournalHeader header{};
+  if (size < sizeof(header) ||
+      !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      header.magic != kJournalMagic || header.version != kJournalVersion ||
+      header.record_size != sizeof(JournalRecord)) {
+    throw std::runtime_error("invalid journal " + path);
+  }
+  std::vector<JournalRecord> records((size - sizeof(header)) /
+                                     sizeof(JournalRecord));
+  file.read(reinterpret_cast<char*>(records.data()),
+            records.size() * sizeof(JournalRecord));
+  return records;
+}
+
+}  // namespace wedge
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace wedge {
+
+enum class JournalEvent : uint8_t {
+  kPlace,
+  kFill,
+  kCancel,
+  kEquity,
+};
+
+// One fixed-size record per event. Fills and equity snapshots carry the
+// account right after the event, unused fields are zero. Orders are named by
+// their placement sequence, slots are reused and would name several orders.
+struct JournalRecord {
+  int64_t time;
+  double quantity;
+  double price;
+  double balance;
+  double position;
+  uint64_t order;
+  JournalEvent event;
+  bool buy;
+  bool market;
+  uint8_t reserved[5];
+};
+
+static_assert(sizeof(JournalRecord) == 56);
+
+struct JournalHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t record_size;
+  uint32_t reserved;
+};
+
+inline constexpr uint32_t kJournalMagic = 0x4e524a57;  // "WJRN"
+inline constexpr uint32_t kJournalVersion = 2;
+
+// Appends records to a preallocated buffer and writes it out only when it is
+// full, nothing is formatted while the backtest runs. wedge.journal renders
+// the file as text.
+class Journal {
+  static constexpr size_t kDefaultCapacity = 1 << 16;
+
+ public:
+  explicit Journal(const std::string& path,
+                   size_t capacity = kDefaultCapacity);
+  ~Journal();
+
+  Journal(const Journal&) = delete;
+  Journal& operator=(const Journal&) = delete;
+
+  void append(const JournalRecord& record) {
+    if (size_ == buffer_.size()) {
+      flush();
+    }
+    buffer_[size_++] = record;
+  }
+
+  void flush();
+
+ private:
+  std::ofstream file_;
+  std::vector<JournalRecord> buffer_;
+  size_t size_ = 0;
+};
+
+std::vector<JournalRecord> read_journal(const std::string& path);
+
+}  // namespace wedge
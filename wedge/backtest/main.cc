@@ -1,10 +1,25 @@
+#include <fmt/format.h>
 #include <nlohmann/json.hpp>
 #include <spdlog/sinks/basic_file_sink.h>
+#include <spdlog/sinks/null_sink.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <fstream>
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
 
 #include "wedge/backtest/backtest_context.h"
+#include "wedge/common/checkpoint.h"
+#include "wedge/common/chrono.h"
+#include "wedge/common/work_stealing_pool.h"
+#include "wedge/dataset/column_dataset.h"
+#include "wedge/dataset/compressed_dataset.h"
+#include "wedge/dataset/dataset_format.h"
+#include "wedge/dataset/load_candles.h"
 #include "wedge/dataset/sql_dataset.h"
 #include "wedge/strategy/strategy.h"
 
@@ -17,16 +32,155 @@ struct StrategyConfig {
   int grid_count;
   double grid_spacing;
   std::string dataset;
-  NLOHMANN_DEFINE_TYPE_INTRUSIVE(StrategyConfig, balance, start_time, end_time,
-                                 grid_count, grid_spacing, dataset)
+  // Write logs/equity.csv with one point per this many minutes, 0 disables.
+  int equity_interval_minutes = 0;
+  // Snapshot the backtest every this many days and resume from the latest
+  // snapshot on the next run with the same parameters, 0 disables.
+  int checkpoint_days = 0;
+  NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(StrategyConfig, balance,
+                                              start_time, end_time, grid_count,
+                                              grid_spacing, dataset,
+                                              equity_interval_minutes,
+                                              checkpoint_days)
 };
 
+// Inclusive range of values for one swept parameter.
+struct SweepRange {
+  double start;
+  double stop;
+  double step = 1;
+  NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(SweepRange, start, stop, step)
+
+  std::vector<double> values() const {
+    std::vector<double> result;
+    for (int i = 0; start + i * step <= stop + step * 1e-9; i++) {
+      result.push_back(start + i * step);
+    }
+    return result;
+  }
+};
+
+// Optional "sweep" section of strategy.json, every combination of the two
+// ranges is backtested against the same candles.
+struct SweepConfig {
+  SweepRange grid_count;
+  SweepRange grid_spacing;
+  int threads = 0;
+  NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(SweepConfig, grid_count,
+                                              grid_spacing, threads)
+};
+
+struct SweepResult {
+  int grid_count;
+  double grid_spacing;
+  PerformanceSummary summary;
+};
+
+static SweepResult run_sweep_point(const StrategyConfig& config,
+                                   int grid_count, double grid_spacing,
+                                   std::span<const Candle> candles) {
+  auto logger = std::make_shared<spdlog::logger>(
+      "sweep", std::make_shared<spdlog::sinks::null_sink_st>());
+  logger->set_level(spdlog::level::off);
+
+  BacktestContext context(config.balance, 0, 0.001);
+  auto broker = context.broker();
+  auto strategy = grid_strategy();
+  nlohmann::json json = config;
+  json["grid_count"] = grid_count;
+  json["grid_spacing"] = grid_spacing;
+  strategy->from_json(json);
+  strategy->set_broker(broker.get());
+  strategy->set_logger(logger);
+  context.set_strategy(std::move(strategy));
+  context.run(candles);
+
+  return SweepResult{
+      .grid_count = grid_count,
+      .grid_spacing = grid_spacing,
+      .summary = context.stats().summary(),
+  };
+}
+
+static int sweep(const StrategyConfig& config, const SweepConfig& sweep) {
+  auto start = std::chrono::steady_clock::now();
+  auto dataset_path = PROJECT_ROOT_DIR "/dataset/" + config.dataset;
+  // Loaded once and only read afterwards, every run shares the same buffer.
+  const std::vector<Candle> candles =
+      load_candles(dataset_path, as_unix_timestamp(config.start_time),
+                   as_unix_timestamp(config.end_time));
+
+  std::vector<SweepResult> results;
+  for (double grid_count : sweep.grid_count.values()) {
+    for (double grid_spacing : sweep.grid_spacing.values()) {
+      results.push_back(SweepResult{
+          .grid_count = static_cast<int>(grid_count),
+          .grid_spacing = grid_spacing,
+      });
+    }
+  }
+
+  size_t threads = sweep.threads > 0 ? sweep.threads
+                                     : std::thread::hardware_concurrency();
+  {
+    WorkStealingPool pool(threads);
+    for (SweepResult& result : results) {
+      pool.submit([&] {
+        result = run_sweep_point(config, result.grid_count,
+                                 result.grid_spacing, candles);
+      });
+    }
+    pool.wait();
+  }
+
+  std::sort(results.begin(), results.end(),
+            [](const SweepResult& lhs, const SweepResult& rhs) {
+              return lhs.summary.final_equity > rhs.summary.final_equity;
+            });
+  fmt::print(
+      "{:>10} {:>12} {:>14} {:>9} {:>8} {:>7} {:>7} {:>7} {:>10} {:>9}\n",
+      "grid_count", "grid_spacing", "equity", "return", "drawdown", "sharpe",
+      "sortino", "fills", "fees", "turnover");
+  for (const SweepResult& result : results) {
+    const PerformanceSummary& s = result.summary;
+    fmt::print(
+        "{:>10} {:>12.6f} {:>14.4f} {:>8.2f}% {:>7.2f}% {:>7.2f} {:>7.2f} "
+        "{:>7} {:>10.4f} {:>9.2f}\n",
+        result.grid_count, result.grid_spacing, s.final_equity,
+        s.total_return * 100, s.max_drawdown * 100, s.sharpe, s.sortino,
+        s.buy_fills + s.sell_fills, s.fees, s.turnover);
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  fmt::print("{} runs over {} candles on {} threads in {:.2f}s\n",
+             results.size(), candles.size(), threads, elapsed.count());
+  return 0;
+}
+
+static void print_summary(const PerformanceSummary& summary) {
+  fmt::print("candles      {}\n", summary.candles);
+  fmt::print("equity       {:.4f} -> {:.4f}\n", summary.initial_equity,
+             summary.final_equity);
+  fmt::print("return       {:.2f}%\n", summary.total_return * 100);
+  fmt::print("max drawdown {:.2f}%\n", summary.max_drawdown * 100);
+  fmt::print("sharpe       {:.3f}\n", summary.sharpe);
+  fmt::print("sortino      {:.3f}\n", summary.sortino);
+  fmt::print("fills        {} buy {} sell\n", summary.buy_fills,
+             summary.sell_fills);
+  fmt::print("fees         {:.4f}\n", summary.fees);
+  fmt::print("turnover     {:.2f}\n", summary.turnover);
+}
+
 int main() {
   auto config_path = PROJECT_ROOT_DIR "/.wedge/strategy.json";
   std::ifstream config_file(config_path);
   nlohmann::json j;
   config_file >> j;
   auto config = j.get<StrategyConfig>();
+  if (j.contains("sweep")) {
+    return sweep(config, j["sweep"].get<SweepConfig>());
+  }
 
   auto logger = spdlog::basic_logger_st("backtest",
                                         PROJECT_ROOT_DIR "/logs/out.log", true);
@@ -40,13 +194,66 @@ int main() {
   strategy->set_logger(logger);
   context.set_strategy(std::move(strategy));
 
-  auto dataset_path = PROJECT_ROOT_DIR "/dataset/" + config.dataset;
-  SqlDataset dataset(dataset_path);
+  Journal journal(PROJECT_ROOT_DIR "/logs/out.journal");
+  context.set_journal(&journal);
+  context.stats().sample_equity(config.equity_interval_minutes * 60'000LL);
 
-  context.set_logger(logger);
+  int64_t start_time = as_unix_timestamp(config.start_time);
+  int64_t end_time = as_unix_timestamp(config.end_time);
+  if (config.checkpoint_days > 0) {
+    // Everything that shapes the run up to a checkpoint, end_time only
+    // decides how far it goes.
+    nlohmann::json key = {
+        {"balance", config.balance},
+        {"start_time", config.start_time},
+        {"grid_count", config.grid_count},
+        {"grid_spacing", config.grid_spacing},
+        {"dataset", config.dataset},
+        {"equity_interval_minutes", config.equity_interval_minutes},
+    };
+    auto directory = fmt::format(PROJECT_ROOT_DIR "/.wedge/checkpoints/{:016x}",
+                                 std::hash<std::string>()(key.dump()));
+    auto latest = latest_checkpoint(directory, end_time);
+    if (latest && latest->second["key"] == key) {
+      context.restore(latest->second["context"]);
+      start_time = latest->first + 1;
+      logger->info("resume from checkpoint {}", latest->first);
+    }
+    context.set_checkpoint(
+        config.checkpoint_days * 24 * 60 * 60'000LL,
+        [&context, key, directory](int64_t time) {
+          nlohmann::json checkpoint = {{"key", key}};
+          context.checkpoint(checkpoint["context"]);
+          write_checkpoint(directory, time, checkpoint);
+        });
+  }
 
-  context.run(dataset.iterator(config.start_time, config.end_time));
+  auto dataset_path = PROJECT_ROOT_DIR "/dataset/" + config.dataset;
+  switch (dataset_format(dataset_path)) {
+    case DatasetFormat::kSql: {
+      SqlDataset dataset(dataset_path);
+      context.run(dataset.iterator(start_time, end_time));
+      break;
+    }
+    case DatasetFormat::kColumn: {
+      ColumnDataset dataset(dataset_path);
+      context.run(dataset.iterator(start_time, end_time));
+      break;
+    }
+    case DatasetFormat::kCompressed: {
+      CompressedDataset dataset(dataset_path);
+      context.run(dataset.iterator(start_time, end_time));
+      break;
+    }
+  }
 
-  auto& account = context.account();
+  print_summary(context.stats().summary());
+  if (config.equity_interval_minutes > 0) {
+    std::ofstream equity_file(PROJECT_ROOT_DIR "/logs/equity.csv");
+    equity_file << "time,equity\n";
+    for (const EquityPoint& point : context.stats().equity_curve()) {
+      equity_file << point.time << ',' << point.equity << '\n';
+    }
+  }
   return 0;
 }
\ No newline at end of file
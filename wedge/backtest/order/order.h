@@ -1,22 +1,65 @@
 #pragma once
 
-#include <memory>
+#include <optional>
+#include <variant>
 
 #include "wedge/common/candle.h"
+#include "wedge/common/enums.h"
 
 namespace wedge {
 
 class BacktestContext;
 
-class IOrder {
- public:
-  virtual ~IOrder() = default;
-  virtual bool update(BacktestContext& context, const Candle& candle) = 0;
+struct LimitBuyOrder {
+  double quantity;
+  double price;
+
+  bool update(BacktestContext& context, const Candle& candle) const;
+};
+
+struct LimitSellOrder {
+  double quantity;
+  double price;
+
+  bool update(BacktestContext& context, const Candle& candle) const;
+};
+
+// Market orders have no price and try to execute on every candle.
+struct MarketBuyOrder {
+  double quantity;
+
+  bool update(BacktestContext& context, const Candle& candle) const;
 };
 
-std::unique_ptr<IOrder> limit_buy_order(double quantity, double price);
-std::unique_ptr<IOrder> limit_sell_order(double quantity, double price);
-std::unique_ptr<IOrder> market_buy_order(double quantity);
-std::unique_ptr<IOrder> market_sell_order(double quantity);
+struct MarketSellOrder {
+  double quantity;
+
+  bool update(BacktestContext& context, const Candle& candle) const;
+};
+
+using Order = std::variant<LimitBuyOrder, LimitSellOrder, MarketBuyOrder,
+                           MarketSellOrder>;
+
+inline OrderSide order_side(const Order& order) {
+  if (std::holds_alternative<LimitBuyOrder>(order) ||
+      std::holds_alternative<MarketBuyOrder>(order)) {
+    return OrderSide::kBuy;
+  }
+  return OrderSide::kSell;
+}
+
+inline double order_quantity(const Order& order) {
+  return std::visit([](const auto& order) { return order.quantity; }, order);
+}
+
+inline std::optional<double> order_price(const Order& order) {
+  if (auto limit = std::get_if<LimitBuyOrder>(&order)) {
+    return limit->price;
+  }
+  if (auto limit = std::get_if<LimitSellOrder>(&order)) {
+    return limit->price;
+  }
+  return std::nullopt;
+}
 
-}  // namespace wedge
\ No newline at end of file
+}  // namespace wedge
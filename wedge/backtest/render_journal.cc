@@ -0,0 +1,68 @@
+#include <fmt/chrono.h>
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <exception>
+
+#include "wedge/backtest/journal.h"
+
+using namespace wedge;
+
+static std::string convert_unix_timestamp_ms(int64_t timestamp_ms) {
+  std::chrono::milliseconds ms(timestamp_ms);
+  std::chrono::seconds s = std::chrono::duration_cast<std::chrono::seconds>(ms);
+  std::time_t time_t_value = s.count();
+  std::tm* tm = std::localtime(&time_t_value);
+  return fmt::format("{:%Y-%m-%d %H:%M:%S}", *tm);
+}
+
+static void render(const JournalRecord& record) {
+  std::string time = convert_unix_timestamp_ms(record.time);
+  const char* side = record.buy ? "buy" : "sell";
+  switch (record.event) {
+    case JournalEvent::kPlace:
+      if (record.market) {
+        fmt::print("{} {}th market {} quantity {}\n", time, record.order, side,
+                   record.quantity);
+      } else {
+        fmt::print("{} {}th limit {} quantity {} price {}\n", time,
+                   record.order, side, record.quantity, record.price);
+      }
+      break;
+    case JournalEvent::kFill: {
+      // Costs were logged as negative amounts.
+      double amount = record.quantity * record.price;
+      fmt::print("{} {}th {} order {} {:.4f} with price {:.4f}\n", time,
+                 record.order, side, record.buy ? "cost" : "income",
+                 record.buy ? -amount : amount, record.price);
+      break;
+    }
+    case JournalEvent::kCancel:
+      fmt::print("{} cancel {}th order\n", time, record.order);
+      break;
+    case JournalEvent::kEquity:
+      fmt::print(
+          "{} balance {:.4f} value {:.4f} price {:.4f} position {:.4f}e-5\n",
+          time, record.balance, record.balance + record.position * record.price,
+          record.price, record.position * 1e5);
+      break;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    std::fprintf(stderr, "usage: %s <journal>\n", argv[0]);
+    return 1;
+  }
+  try {
+    for (const JournalRecord& record : read_journal(argv[1])) {
+      render(record);
+    }
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -2,5 +2,11 @@
 target("wedge.backtest", function () 
   set_kind("binary")
   add_files("*.cc", "*/*.cc")
+  remove_files("render_journal.cc")
   add_deps("wedge.dataset", "wedge.strategy")
-end)
\ No newline at end of file
+end)
+
+target("wedge.journal", function () 
+  set_kind("binary")
+  add_files("journal.cc", "render_journal.cc")
+end)
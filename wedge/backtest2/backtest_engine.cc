@@ -1,94 +1,436 @@
 #include "wedge/backtest2/backtest_engine.h"
 
+#include <algorithm>
 #include <cassert>
 
 namespace wedge {
 
+static bool is_open(OrderStatus status) {
+  return status == OrderStatus::kNew || status == OrderStatus::kPendingNew;
+}
+
 uint64_t BacktestEngine::add_base_order(std::unique_ptr<OrderBase> order) {
-  uint64_t order_id = orders_.size();
-  if (order->is_status(OrderStatus::kNew)) {
-    new_orders_.push_back(order_id);
+  uint64_t order_id = orders_.allocate();
+  orders_[order_id].order = std::move(order);
+  if (orders_[order_id].order->is_status(OrderStatus::kNew)) {
+    activate(order_id);
   }
-  orders_.push_back(std::move(order));
+  created_orders_.push_back(order_id);
   return order_id;
 }
 
+void BacktestEngine::activate(uint64_t order_id) {
+  orders_[order_id].sequence = next_sequence_++;
+  add_resting(order_id);
+}
+
+void BacktestEngine::add_resting(uint64_t order_id) {
+  const OrderEntry& entry = orders_[order_id];
+  Trigger trigger = entry.order->trigger();
+  switch (trigger.on) {
+    case TriggerOn::kLow:
+      low_ladder_.insert(trigger.price, entry.sequence, order_id);
+      break;
+    case TriggerOn::kHigh:
+      high_ladder_.insert(trigger.price, entry.sequence, order_id);
+      break;
+    case TriggerOn::kAny:
+      market_orders_.push_back(order_id);
+      break;
+  }
+}
+
+void BacktestEngine::remove_resting(uint64_t order_id) {
+  const OrderEntry& entry = orders_[order_id];
+  Trigger trigger = entry.order->trigger();
+  switch (trigger.on) {
+    case TriggerOn::kLow:
+      low_ladder_.erase(trigger.price, entry.sequence);
+      break;
+    case TriggerOn::kHigh:
+      high_ladder_.erase(trigger.price, entry.sequence);
+      break;
+    case TriggerOn::kAny:
+      std::erase(market_orders_, order_id);
+      break;
+  }
+}
+
+void BacktestEngine::cancel_order(uint64_t order_id) {
+  OrderBase& order = *orders_[order_id].order;
+  if (order.is_status(OrderStatus::kNew)) {
+    remove_resting(order_id);
+  }
+  order.status(OrderStatus::kCanceled);
+}
+
 uint64_t BacktestEngine::add_order_list(std::initializer_list<uint64_t> list) {
-  uint64_t result = order_lists_.size();
-  order_lists_.emplace_back(list.begin(), list.end());
+  uint64_t result = order_lists_.allocate();
+  std::vector<Order>& orders = order_lists_[result];
+  for (uint64_t order_id : list) {
+    orders_[order_id].order_list_id = result;
+    orders.push_back(Order{
+        .order_id = order_id,
+        .order_list_id = result,
+        .status = orders_[order_id].order->status(),
+    });
+  }
+  created_order_lists_.push_back(result);
   return result;
 }
 
+void BacktestEngine::release_order(uint64_t order_id) {
+  OrderEntry& entry = orders_[order_id];
+  entry.order.reset();
+  entry.order_list_id.reset();
+  orders_.erase(order_id);
+}
+
+void BacktestEngine::release_order_list(uint64_t order_list_id) {
+  std::vector<Order>& orders = order_lists_[order_list_id];
+  for (const Order& order : orders) {
+    release_order(order.order_id);
+  }
+  // Keeps its capacity for the next list in this slot.
+  orders.clear();
+  order_lists_.erase(order_list_id);
+}
+
 uint64_t BacktestEngine::add_oco(uint64_t above, uint64_t below) {
-  orders_[above]->add_canceled(below);
-  orders_[below]->add_canceled(above);
+  orders_[above].order->add_canceled(below);
+  orders_[below].order->add_canceled(above);
   return add_order_list({above, below});
 }
 
 uint64_t BacktestEngine::add_oto(uint64_t working, uint64_t pending) {
-  orders_[working]->add_triggered(pending);
+  orders_[working].order->add_triggered(pending);
   return add_order_list({working, pending});
 }
 
 uint64_t BacktestEngine::add_otoco(uint64_t working, uint64_t pending_above,
                                    uint64_t pending_below) {
-  orders_[working]->add_triggered(pending_above);
-  orders_[working]->add_triggered(pending_below);
-  orders_[pending_above]->add_canceled(pending_below);
-  orders_[pending_below]->add_canceled(pending_above);
+  orders_[working].order->add_triggered(pending_above);
+  orders_[working].order->add_triggered(pending_below);
+  orders_[pending_above].order->add_canceled(pending_below);
+  orders_[pending_below].order->add_canceled(pending_above);
   return add_order_list({working, pending_above, pending_below});
 }
 
-void BacktestEngine::on_event(const FillOrderEvent& event) {
-  switch (event.side) {
-    case OrderSide::kBuy:
-      base_ += event.base * (1 - 1e-4);
-      quote_ -= event.quote;
-      break;
-    case OrderSide::kSell:
-      base_ -= event.base;
-      quote_ += event.quote * (1 - 1e-4);
-      break;
+void BacktestEngine::settle() {
+  for (const FillOrderEvent& event : fills_) {
+    OrderBase& order = *orders_[event.order_id].order;
+    // Canceled by an earlier fill of its order list.
+    if (!order.is_status(OrderStatus::kNew)) {
+      continue;
+    }
+    order.status(OrderStatus::kFilled);
+    switch (event.side) {
+      case OrderSide::kBuy:
+        base_ += event.base * (1 - 1e-4);
+        quote_ -= event.quote;
+        break;
+      case OrderSide::kSell:
+        base_ -= event.base;
+        quote_ += event.quote * (1 - 1e-4);
+        break;
+    }
+    // Both sides pay the fee on what they receive, valued here in quote.
+    stats_.on_fill(event.side, event.quote, event.quote * 1e-4);
+
+    for (uint64_t order_id : order.triggered()) {
+      assert(orders_[order_id].order->is_status(OrderStatus::kPendingNew));
+      orders_[order_id].order->status(OrderStatus::kNew);
+      activate(order_id);
+    }
+    for (uint64_t order_id : order.canceled()) {
+      cancel_order(order_id);
+    }
+  }
+  fills_.clear();
+}
+
+void BacktestEngine::checkpoint(StrategyBase* strategy,
+                                nlohmann::json& json) const {
+  json["base"] = base_;
+  json["quote"] = quote_;
+  json["next_sequence"] = next_sequence_;
+  orders_.to_json(json["orders"], [](const OrderEntry& entry,
+                                     nlohmann::json& json) {
+    entry.order->to_json(json);
+    json["sequence"] = entry.sequence;
+    if (entry.order_list_id) {
+      json["order_list_id"] = *entry.order_list_id;
+    }
+  });
+  order_lists_.to_json(json["order_lists"], [](const std::vector<Order>& list,
+                                               nlohmann::json& json) {
+    json = nlohmann::json::array();
+    for (const Order& order : list) {
+      json.push_back(order.order_id);
+    }
+  });
+  json["stats"] = stats_;
+  strategy->to_json(json["strategy"]);
+}
+
+void BacktestEngine::restore(StrategyBase* strategy,
+                             const nlohmann::json& json) {
+  base_ = json["base"];
+  quote_ = json["quote"];
+  orders_.from_json(json["orders"], [this](const nlohmann::json& json,
+                                           OrderEntry& entry) {
+    entry.order = order_from_json(json);
+    entry.sequence = json["sequence"];
+    if (json.contains("order_list_id")) {
+      entry.order_list_id = json["order_list_id"].get<uint64_t>();
+    }
+  });
+  next_sequence_ = json["next_sequence"];
+  low_ladder_.clear();
+  high_ladder_.clear();
+  market_orders_.clear();
+  orders_.for_each([this](uint64_t order_id, const OrderEntry& entry) {
+    if (entry.order->is_status(OrderStatus::kNew)) {
+      add_resting(order_id);
+    }
+  });
+  std::sort(market_orders_.begin(), market_orders_.end(),
+            [this](uint64_t lhs, uint64_t rhs) {
+              return orders_[lhs].sequence < orders_[rhs].sequence;
+            });
+  order_lists_.from_json(json["order_lists"], [this](const nlohmann::json& ids,
+                                                     std::vector<Order>& list) {
+    for (uint64_t order_id : ids) {
+      const OrderEntry& entry = orders_[order_id];
+      list.push_back(
+          Order{order_id, entry.order_list_id, entry.order->status()});
+    }
+  });
+  // Every restored order and list goes through sync_open_tables again.
+  open_orders_.clear();
+  open_order_lists_.clear();
+  created_orders_.clear();
+  created_order_lists_.clear();
+  orders_.for_each([this](uint64_t order_id, const OrderEntry&) {
+    created_orders_.push_back(order_id);
+  });
+  order_lists_.for_each([this](uint64_t order_list_id, const auto&) {
+    created_order_lists_.push_back(order_list_id);
+  });
+  stats_ = json["stats"].get<PerformanceStats>();
+  strategy->from_json(json["strategy"]);
+}
+
+bool BacktestEngine::is_ambiguous(const Candle& candle) const {
+  int candidates = 0;
+  auto count = [&](uint64_t order_id) {
+    candidates++;
+    // Orders this fill activates may fill within the same candle as well.
+    for (uint64_t pending_id : orders_[order_id].order->triggered()) {
+      if (orders_[pending_id].order->could_fill(candle)) {
+        candidates++;
+      }
+    }
+    return candidates > 1;
+  };
+  for (const TriggerLadder* ladder : {&low_ladder_, &high_ladder_}) {
+    size_t crossed = ladder->crossed(candle);
+    for (uint64_t order_id : ladder->order_ids().last(crossed)) {
+      if (count(order_id)) {
+        return true;
+      }
+    }
   }
+  for (uint64_t order_id : market_orders_) {
+    if (count(order_id)) {
+      return true;
+    }
+  }
+  return false;
 }
 
-void BacktestEngine::on_event(const TriggerOrderEvent& event) {
-  for (uint64_t order_id : event.orders) {
-    assert(orders_[order_id]->is_status(OrderStatus::kPendingNew));
-    orders_[order_id]->status(OrderStatus::kNew);
-    new_orders_.push_back(order_id);
+// Sub-candles with a gap could skip the candle's high or low and miss fills
+// the candle itself would make.
+static bool covers(const Candle& candle, std::span<const Candle> sub_candles) {
+  double high = sub_candles.front().high_price;
+  double low = sub_candles.front().low_price;
+  for (const Candle& sub_candle : sub_candles) {
+    high = std::max(high, sub_candle.high_price);
+    low = std::min(low, sub_candle.low_price);
   }
+  return high >= candle.high_price && low <= candle.low_price;
 }
 
-void BacktestEngine::on_event(const CancelOrderEvent& event) {
-  for (uint64_t order_id : event.orders) {
-    orders_[order_id]->status(OrderStatus::kCanceled);
+void BacktestEngine::update_orders(const Candle& candle) {
+  size_t sub_count = 0;
+  if (sub_candles_ && is_ambiguous(candle)) {
+    constexpr int64_t kMinuteMs = 60 * 1000;
+    size_t minutes = (candle.close_time - candle.open_time) / kMinuteMs + 1;
+    if (sub_candle_buffer_.size() < minutes) {
+      sub_candle_buffer_.resize(minutes);
+    }
+    sub_count = sub_candles_->load(candle.open_time, candle.close_time,
+                                   sub_candle_buffer_);
+    auto sub_candles = std::span<const Candle>(sub_candle_buffer_);
+    if (sub_count < minutes ||
+        !covers(candle, sub_candles.first(sub_count))) {
+      sub_count = 0;
+    }
+  }
+  if (sub_count == 0) {
+    update_new_orders(candle);
+  }
+  for (size_t i = 0; i < sub_count; i++) {
+    update_new_orders(sub_candle_buffer_[i]);
   }
+  stats_.on_candle(candle.close_time, quote_ + base_ * candle.close_price);
 }
 
 void BacktestEngine::update_new_orders(const Candle& candle) {
-  auto iter = new_orders_.begin();
-  for (; iter != new_orders_.end(); ++iter) {
-    OrderBase* order = orders_[*iter].get();
-    if (order->is_status(OrderStatus::kNew)) {
-      order->update(candle);
+  // Each round fills what the candle crosses and settles it. Settling may
+  // trigger orders into the ladders, which then get a chance to fill on the
+  // same candle after every order crossed before them.
+  for (;;) {
+    crossed_.clear();
+    for (TriggerLadder* ladder : {&low_ladder_, &high_ladder_}) {
+      size_t crossed = ladder->crossed(candle);
+      std::span<const uint64_t> sequences = ladder->sequences().last(crossed);
+      std::span<const uint64_t> order_ids = ladder->order_ids().last(crossed);
+      for (size_t i = 0; i < crossed; i++) {
+        crossed_.emplace_back(sequences[i], order_ids[i]);
+      }
+      ladder->pop(crossed);
+    }
+    for (uint64_t order_id : market_orders_) {
+      crossed_.emplace_back(orders_[order_id].sequence, order_id);
+    }
+    market_orders_.clear();
+    if (crossed_.empty()) {
+      break;
+    }
+    std::sort(crossed_.begin(), crossed_.end());
+    for (auto [sequence, order_id] : crossed_) {
+      FillOrderEvent& event =
+          fills_.emplace_back(orders_[order_id].order->fill(candle));
+      event.order_id = order_id;
     }
+    settle();
   }
-  auto new_end = std::remove_if(
-      new_orders_.begin(), new_orders_.end(), [this](uint64_t order_id) {
-        return !orders_[order_id]->is_status(OrderStatus::kNew);
-      });
-  new_orders_.erase(new_end, new_orders_.end());
 }
 
 void BacktestEngine::execute(const CancelOrder& command) {
-  orders_[command.order_id]->status(OrderStatus::kCanceled);
+  // Ids of released orders and lists are stale, they were closed anyway.
+  if (!orders_.contains(command.order_id)) {
+    return;
+  }
+  if (is_open(orders_[command.order_id].order->status())) {
+    cancel_order(command.order_id);
+  }
 }
 
 void BacktestEngine::execute(const CancelOrderList& command) {
-  for (uint64_t order_id : order_lists_[command.order_list_id]) {
-    orders_[order_id]->status(OrderStatus::kCanceled);
+  if (!order_lists_.contains(command.order_list_id)) {
+    return;
+  }
+  for (const Order& entry : order_lists_[command.order_list_id]) {
+    if (is_open(orders_[entry.order_id].order->status())) {
+      cancel_order(entry.order_id);
+    }
+  }
+}
+
+void BacktestEngine::run(StrategyBase* strategy,
+                         std::span<const Candle> candles) {
+  for (const Candle& candle : candles) {
+    strategy->on_event(step(candle));
+    if (checkpoint_interval_ > 0 &&
+        candle.close_time + 1 >= next_checkpoint_) {
+      take_checkpoint(candle);
+    }
+  }
+}
+
+void BacktestEngine::take_checkpoint(const Candle& candle) {
+  // The first boundary is the end of the window the first candle opens in.
+  if (next_checkpoint_ == 0) {
+    next_checkpoint_ =
+        (candle.open_time / checkpoint_interval_ + 1) * checkpoint_interval_;
+  }
+  if (candle.close_time + 1 < next_checkpoint_) {
+    return;
+  }
+  checkpoint_callback_(candle.close_time);
+  next_checkpoint_ = ((candle.close_time + 1) / checkpoint_interval_ + 1) *
+                     checkpoint_interval_;
+}
+
+ScheduleTaskEvent BacktestEngine::step(const Candle& candle) {
+  update_orders(candle);
+  sync_open_tables();
+  return ScheduleTaskEvent{
+      .base = base_,
+      .quote = quote_,
+      .current_candle = candle,
+      .open_orders = open_orders_,
+      .open_order_lists = open_order_lists_,
+  };
+}
+
+void BacktestEngine::sync_open_tables() {
+  for (Order& order : open_orders_) {
+    order.status = orders_[order.order_id].order->status();
+  }
+  // Orders in a list are released with the list.
+  std::erase_if(open_orders_, [this](const Order& order) {
+    if (is_open(order.status)) {
+      return false;
+    }
+    if (!order.order_list_id) {
+      release_order(order.order_id);
+    }
+    return true;
+  });
+  for (uint64_t order_id : created_orders_) {
+    const OrderEntry& entry = orders_[order_id];
+    OrderStatus status = entry.order->status();
+    if (is_open(status)) {
+      open_orders_.push_back(Order{
+          .order_id = order_id,
+          .order_list_id = entry.order_list_id,
+          .status = status,
+      });
+    } else if (!entry.order_list_id) {
+      release_order(order_id);
+    }
+  }
+  created_orders_.clear();
+
+  auto refresh = [this](uint64_t order_list_id) {
+    bool open = false;
+    for (Order& order : order_lists_[order_list_id]) {
+      order.status = orders_[order.order_id].order->status();
+      open |= is_open(order.status);
+    }
+    return open;
+  };
+  std::erase_if(open_order_lists_, [&](const OrderList& list) {
+    if (refresh(list.order_list_id)) {
+      return false;
+    }
+    release_order_list(list.order_list_id);
+    return true;
+  });
+  for (uint64_t order_list_id : created_order_lists_) {
+    if (refresh(order_list_id)) {
+      open_order_lists_.push_back(OrderList{
+          .order_list_id = order_list_id,
+          .orders = order_lists_[order_list_id],
+      });
+    } else {
+      release_order_list(order_list_id);
+    }
   }
+  created_order_lists_.clear();
 }
 
 class OrderExecutor {
@@ -1,37 +1,82 @@
 #pragma once
 
+#include <nlohmann/json.hpp>
+
 #include <deque>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <span>
 #include <vector>
 
 #include "wedge/backtest2/order.h"
+#include "wedge/backtest2/sub_candle_source.h"
+#include "wedge/backtest2/trigger_ladder.h"
+#include "wedge/common/performance_stats.h"
+#include "wedge/common/slot_map.h"
 #include "wedge/strategy2/broker.h"
 #include "wedge/strategy2/strategy.h"
 
 namespace wedge {
 
-class BacktestEngine final : public OrderListener, public Broker {
+class BacktestEngine final : public Broker {
+  static constexpr size_t kBatchSize = 1024;
+
+  struct OrderEntry {
+    std::unique_ptr<OrderBase> order;
+    std::optional<uint64_t> order_list_id;
+    // When the order last became kNew, orders crossed by the same candle
+    // fill in this order.
+    uint64_t sequence = 0;
+  };
+
  public:
   BacktestEngine(double base, double quote) : base_(base), quote_(quote) {}
 
-  void run(StrategyBase* strategy);
+  // Fills orders against every candle, then hands it to the strategy.
+  template <class Iterator>
+  void run(StrategyBase* strategy, Iterator iterator) {
+    std::vector<Candle> buffer(kBatchSize);
+    while (size_t count = iterator.next_batch(buffer)) {
+      run(strategy, std::span<const Candle>(buffer).first(count));
+    }
+  }
+
+  void run(StrategyBase* strategy, std::span<const Candle> candles);
+
+  // Fills orders against `candle` and returns the event for the strategy,
+  // for drivers that call the strategy themselves.
+  ScheduleTaskEvent step(const Candle& candle);
 
   template <class OrderType, class... Args>
   uint64_t add_order(Args&&... args) {
-    auto order = std::make_unique<OrderType>(this, args...);
+    auto order = std::make_unique<OrderType>(args...);
     return add_base_order(std::move(order));
   }
 
+  PerformanceStats& stats() { return stats_; }
+
+  // Balances, orders, order lists, statistics and the strategy's to_json.
+  void checkpoint(StrategyBase* strategy, nlohmann::json& json) const;
+  void restore(StrategyBase* strategy, const nlohmann::json& json);
+
+  // Calls `callback` from run with the close time of the last candle in
+  // every `interval_ms` window, right after the strategy has seen it.
+  void set_checkpoint(int64_t interval_ms,
+                      std::function<void(int64_t)> callback) {
+    checkpoint_interval_ = interval_ms;
+    checkpoint_callback_ = std::move(callback);
+  }
+
+  // Candles where more than one order could fill are replayed minute by
+  // minute from `source`, so the fill order follows the real price path.
+  void set_sub_candles(SubCandleSource* source) { sub_candles_ = source; }
+
   uint64_t add_oco(uint64_t above, uint64_t below);
   uint64_t add_oto(uint64_t working, uint64_t pending);
   uint64_t add_otoco(uint64_t working, uint64_t pending_above,
                      uint64_t pending_below);
 
-  // OrderListener interface
-  void on_event(const FillOrderEvent& event) override;
-  void on_event(const TriggerOrderEvent& event) override;
-  void on_event(const CancelOrderEvent& event) override;
-
   // Broker interface
   void execute(const CancelOrder& command) override;
   void execute(const CancelOrderList& command) override;
@@ -41,13 +86,53 @@ class BacktestEngine final : public OrderListener, public Broker {
  private:
   uint64_t add_order_list(std::initializer_list<uint64_t> list);
   uint64_t add_base_order(std::unique_ptr<OrderBase> order);
+  void update_orders(const Candle& candle);
   void update_new_orders(const Candle& candle);
+  void settle();
+  bool is_ambiguous(const Candle& candle) const;
+  void sync_open_tables();
+  void take_checkpoint(const Candle& candle);
+
+  void activate(uint64_t order_id);
+  void add_resting(uint64_t order_id);
+  void remove_resting(uint64_t order_id);
+  void cancel_order(uint64_t order_id);
+  void release_order(uint64_t order_id);
+  void release_order_list(uint64_t order_list_id);
 
   double base_;
   double quote_;
-  std::deque<uint64_t> new_orders_;
-  std::vector<std::vector<uint64_t>> order_lists_;
-  std::vector<std::unique_ptr<OrderBase>> orders_;
+  // kNew orders, the ladders hold priced orders and market orders wait in
+  // a FIFO for the next candle.
+  TriggerLadder low_ladder_{TriggerOn::kLow};
+  TriggerLadder high_ladder_{TriggerOn::kHigh};
+  std::deque<uint64_t> market_orders_;
+  uint64_t next_sequence_ = 0;
+  // (sequence, order id) of the orders one candle crosses, and their fills
+  // in the same order until settle applies them.
+  std::vector<std::pair<uint64_t, uint64_t>> crossed_;
+  std::vector<FillOrderEvent> fills_;
+  // Ids are slot map ids, closed orders and lists are released by
+  // sync_open_tables so their slots are reused. Order list members are
+  // released with their list, as they refer to each other.
+  SlotMap<std::vector<Order>> order_lists_;
+  SlotMap<OrderEntry> orders_;
+
+  // Open orders and order lists shown to the strategy. They are only
+  // changed by sync_open_tables between strategy calls, in O(open orders)
+  // and without allocating once they reach their working size.
+  std::vector<Order> open_orders_;
+  std::vector<OrderList> open_order_lists_;
+  // Created since the last sync_open_tables.
+  std::vector<uint64_t> created_orders_;
+  std::vector<uint64_t> created_order_lists_;
+  PerformanceStats stats_;
+  SubCandleSource* sub_candles_ = nullptr;
+  std::vector<Candle> sub_candle_buffer_;
+
+  int64_t checkpoint_interval_ = 0;
+  int64_t next_checkpoint_ = 0;
+  std::function<void(int64_t)> checkpoint_callback_;
 };
 
 }  // namespace wedge
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "wedge/common/candle.h"
+#include "wedge/dataset/load_candles.h"
+
+namespace wedge {
+
+// Candles of the most recently used (dataset, window) pairs. Jobs over the
+// same window share one read, and a job asking for a window that is still
+// loading waits for that load instead of starting another.
+class CandleCache {
+ public:
+  using Candles = std::shared_ptr<const std::vector<Candle>>;
+
+  explicit CandleCache(size_t capacity)
+      : capacity_(std::max<size_t>(capacity, 1)) {}
+
+  // Throws what load_candles throws.
+  Candles get(const std::string& path, int64_t start_time, int64_t end_time) {
+    Key key{.path = path, .start_time = start_time, .end_time = end_time};
+    std::promise<Candles> promise;
+    std::shared_future<Candles> candles;
+    bool load = false;
+    {
+      std::lock_guard lock(mutex_);
+      auto it = std::find_if(
+          entries_.begin(), entries_.end(),
+          [&](const Entry& entry) { return entry.key == key; });
+      if (it != entries_.end()) {
+        entries_.splice(entries_.begin(), entries_, it);
+        candles = it->candles;
+      } else {
+        candles = promise.get_future().share();
+        entries_.push_front(Entry{.key = key, .candles = candles});
+        if (entries_.size() > capacity_) {
+          entries_.pop_back();
+        }
+        load = true;
+      }
+    }
+
+    if (load) {
+      try {
+        promise.set_value(std::make_shared<const std::vector<Candle>>(
+            load_candles(path, start_time, end_time)));
+      } catch (...) {
+        promise.set_exception(std::current_exception());
+        // Let the next request try again.
+        std::lock_guard lock(mutex_);
+        entries_.remove_if(
+            [&](const Entry& entry) { return entry.key == key; });
+      }
+    }
+    return candles.get();
+  }
+
+ private:
+  struct Key {
+    std::string path;
+    int64_t start_time;
+    int64_t end_time;
+    bool operator==(const Key&) const = default;
+  };
+
+  struct Entry {
+    Key key;
+    std::shared_future<Candles> candles;
+  };
+
+  size_t capacity_;
+  std::mutex mutex_;
+  // Most recently used first.
+  std::list<Entry> entries_;
+};
+
+}  // namespace wedge
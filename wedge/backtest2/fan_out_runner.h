@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <barrier>
+#include <exception>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "wedge/backtest2/backtest_engine.h"
+#include "wedge/common/candle.h"
+#include "wedge/strategy2/strategy.h"
+
+namespace wedge {
+
+// Runs many engine and strategy pairs over one candle stream that is read
+// only once. Pairs are split across threads, every thread runs its pairs
+// over the same block while it is hot in cache, and the next block is read
+// while the current one is processed.
+class FanOutRunner {
+  static constexpr size_t kBlockSize = 1024;
+
+  struct Pair {
+    BacktestEngine* engine;
+    StrategyBase* strategy;
+    // Set when the pair threw, it skips the rest of the stream.
+    std::exception_ptr error;
+  };
+
+ public:
+  explicit FanOutRunner(
+      size_t thread_count = std::thread::hardware_concurrency())
+      : thread_count_(std::max<size_t>(thread_count, 1)) {}
+
+  void add(BacktestEngine* engine, StrategyBase* strategy) {
+    pairs_.push_back(Pair{.engine = engine, .strategy = strategy});
+  }
+
+  // What the index-th added pair threw during run, if anything.
+  std::exception_ptr error(size_t index) const { return pairs_[index].error; }
+
+  template <class Iterator>
+  void run(Iterator iterator) {
+    size_t thread_count = std::min(thread_count_, pairs_.size());
+    if (thread_count == 0) {
+      return;
+    }
+    for (std::vector<Candle>& buffer : buffers_) {
+      buffer.resize(kBlockSize);
+    }
+    // The reader and every worker meet twice per block, once before the
+    // workers start on it and once after they are done.
+    std::barrier barrier(thread_count + 1);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < thread_count; i++) {
+      size_t first = pairs_.size() * i / thread_count;
+      size_t last = pairs_.size() * (i + 1) / thread_count;
+      auto pairs = std::span<Pair>(pairs_).subspan(first, last - first);
+      threads.emplace_back([this, &barrier, pairs] { work(barrier, pairs); });
+    }
+
+    // A read error ends the stream like its end does, so the workers leave
+    // the barrier before it is rethrown.
+    std::exception_ptr read_error;
+    auto read = [&](size_t index) {
+      try {
+        counts_[index] = iterator.next_batch(buffers_[index]);
+      } catch (...) {
+        read_error = std::current_exception();
+        counts_[index] = 0;
+      }
+    };
+    size_t current = 0;
+    read(current);
+    for (;;) {
+      barrier.arrive_and_wait();
+      if (counts_[current] == 0) {
+        break;
+      }
+      read(current ^ 1);
+      barrier.arrive_and_wait();
+      current ^= 1;
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    if (read_error) {
+      std::rethrow_exception(read_error);
+    }
+  }
+
+ private:
+  void work(std::barrier<>& barrier, std::span<Pair> pairs) {
+    size_t current = 0;
+    for (;;) {
+      barrier.arrive_and_wait();
+      size_t count = counts_[current];
+      if (count == 0) {
+        return;
+      }
+      auto block = std::span<const Candle>(buffers_[current]).first(count);
+      for (Pair& pair : pairs) {
+        if (pair.error) {
+          continue;
+        }
+        try {
+          pair.engine->run(pair.strategy, block);
+        } catch (...) {
+          pair.error = std::current_exception();
+        }
+      }
+      barrier.arrive_and_wait();
+      current ^= 1;
+    }
+  }
+
+  size_t thread_count_;
+  std::vector<Pair> pairs_;
+  std::array<std::vector<Candle>, 2> buffers_;
+  std::array<size_t, 2> counts_{};
+};
+
+}  // namespace wedge
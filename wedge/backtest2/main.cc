@@ -1 +1,331 @@
-int main() { return 0; }
\ No newline at end of file
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "wedge/backtest2/backtest_engine.h"
+#include "wedge/backtest2/candle_cache.h"
+#include "wedge/backtest2/fan_out_runner.h"
+#include "wedge/backtest2/sub_candle_source.h"
+#include "wedge/common/checkpoint.h"
+#include "wedge/common/chrono.h"
+#include "wedge/common/work_stealing_pool.h"
+#include "wedge/dataset/column_dataset.h"
+#include "wedge/dataset/compressed_dataset.h"
+#include "wedge/dataset/dataset_format.h"
+#include "wedge/dataset/sql_dataset.h"
+#include "wedge/strategy2/strategy001.h"
+
+using namespace wedge;
+
+// One backtest of a job file, `params` goes to the strategy's from_json.
+struct Job {
+  std::string name;
+  std::string dataset;
+  std::string start_time;
+  std::string end_time;
+  std::string strategy = "strategy001";
+  nlohmann::json params = nlohmann::json::object();
+  double base = 0;
+  double quote = 10000;
+  // 1m dataset of the same symbol, when set the candles where more than one
+  // order could fill are replayed minute by minute.
+  std::string sub_candles;
+  // Snapshot the job every this many days and resume from the latest
+  // snapshot when a job with the same parameters runs again, 0 disables.
+  int checkpoint_days = 0;
+  NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(Job, name, dataset, start_time,
+                                              end_time, strategy, params, base,
+                                              quote, sub_candles,
+                                              checkpoint_days)
+};
+
+// .wedge/jobs.json unless another path is given on the command line.
+struct JobFile {
+  // 0 uses every core.
+  int threads = 0;
+  // Number of (dataset, window) candle sets kept in memory.
+  int cached_datasets = 4;
+  // One JSON line per finished job, in the order they finish. Jobs over the
+  // same (dataset, window) run together, their "seconds" is the group's.
+  std::string output = "logs/jobs.jsonl";
+  std::vector<Job> jobs;
+  NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(JobFile, threads,
+                                              cached_datasets, output, jobs)
+};
+
+static std::unique_ptr<StrategyBase> make_strategy(const std::string& name,
+                                                   Broker* broker) {
+  if (name == "strategy001") {
+    return std::make_unique<Strategy001>(broker, nullptr);
+  }
+  throw std::runtime_error(fmt::format("unknown strategy {}", name));
+}
+
+// Calls `f` with the candles of the dataset at `path`, which stays open until
+// `f` returns.
+template <class F>
+static void with_sub_candles(const std::string& path, F&& f) {
+  switch (dataset_format(path)) {
+    case DatasetFormat::kSql: {
+      SqlDataset dataset(path);
+      DatasetSubCandles source(&dataset);
+      f(&source);
+      break;
+    }
+    case DatasetFormat::kColumn: {
+      ColumnDataset dataset(path);
+      DatasetSubCandles source(&dataset);
+      f(&source);
+      break;
+    }
+    case DatasetFormat::kCompressed: {
+      CompressedDataset dataset(path);
+      DatasetSubCandles source(&dataset);
+      f(&source);
+      break;
+    }
+  }
+}
+
+// Returns the number of candles the job ran over.
+static size_t run_job(const Job& job, CandleCache& cache,
+                      nlohmann::json& result) {
+  auto candles = cache.get(PROJECT_ROOT_DIR "/dataset/" + job.dataset,
+                           as_unix_timestamp(job.start_time),
+                           as_unix_timestamp(job.end_time));
+  BacktestEngine engine(job.base, job.quote);
+  auto strategy = make_strategy(job.strategy, &engine);
+  strategy->from_json(job.params);
+
+  std::span<const Candle> remaining(*candles);
+  if (job.checkpoint_days > 0) {
+    // Everything that shapes the run up to a checkpoint, end_time only
+    // decides how far it goes.
+    nlohmann::json key = job;
+    key.erase("name");
+    key.erase("end_time");
+    key.erase("checkpoint_days");
+    auto directory = fmt::format(PROJECT_ROOT_DIR "/.wedge/checkpoints/{:016x}",
+                                 std::hash<std::string>()(key.dump()));
+    auto latest = latest_checkpoint(directory, as_unix_timestamp(job.end_time));
+    if (latest && latest->second["key"] == key) {
+      engine.restore(strategy.get(), latest->second["engine"]);
+      int64_t time = latest->first;
+      auto first = std::partition_point(
+          remaining.begin(), remaining.end(),
+          [time](const Candle& candle) { return candle.open_time <= time; });
+      remaining = remaining.subspan(first - remaining.begin());
+      result["resumed_from"] = time;
+    }
+    engine.set_checkpoint(
+        job.checkpoint_days * 24 * 60 * 60'000LL,
+        [&engine, &strategy, key, directory](int64_t time) {
+          nlohmann::json checkpoint = {{"key", key}};
+          engine.checkpoint(strategy.get(), checkpoint["engine"]);
+          write_checkpoint(directory, time, checkpoint);
+        });
+  }
+
+  auto run = [&](SubCandleSource* sub_candles) {
+    engine.set_sub_candles(sub_candles);
+    engine.run(strategy.get(), remaining);
+  };
+  if (job.sub_candles.empty()) {
+    run(nullptr);
+  } else {
+    with_sub_candles(PROJECT_ROOT_DIR "/dataset/" + job.sub_candles, run);
+  }
+  result["summary"] = engine.stats().summary();
+  return remaining.size();
+}
+
+// Copies cached candles out a block at a time, for FanOutRunner.
+class CandleSpanIterator {
+ public:
+  explicit CandleSpanIterator(std::span<const Candle> candles)
+      : candles_(candles) {}
+
+  size_t next_batch(std::span<Candle> candles) {
+    size_t count = std::min(candles.size(), candles_.size());
+    std::copy_n(candles_.begin(), count, candles.begin());
+    candles_ = candles_.subspan(count);
+    return count;
+  }
+
+ private:
+  std::span<const Candle> candles_;
+};
+
+// Jobs over one (dataset, window) without sub-candles or checkpoints, run
+// block by block on `thread_count` threads so every block goes through all
+// of them while it is in cache. Fills results[i] for jobs[i], returns the
+// candles run summed over the jobs that finished.
+static size_t run_jobs(std::span<const Job* const> jobs, CandleCache& cache,
+                       std::vector<nlohmann::json>& results,
+                       size_t thread_count) {
+  const Job& first = *jobs.front();
+  auto candles = cache.get(PROJECT_ROOT_DIR "/dataset/" + first.dataset,
+                           as_unix_timestamp(first.start_time),
+                           as_unix_timestamp(first.end_time));
+  std::vector<std::unique_ptr<BacktestEngine>> engines;
+  std::vector<std::unique_ptr<StrategyBase>> strategies;
+  std::vector<size_t> added;
+  FanOutRunner runner(thread_count);
+  for (size_t i = 0; i < jobs.size(); i++) {
+    const Job& job = *jobs[i];
+    try {
+      auto engine = std::make_unique<BacktestEngine>(job.base, job.quote);
+      auto strategy = make_strategy(job.strategy, engine.get());
+      strategy->from_json(job.params);
+      runner.add(engine.get(), strategy.get());
+      engines.push_back(std::move(engine));
+      strategies.push_back(std::move(strategy));
+      added.push_back(i);
+    } catch (const std::exception& e) {
+      results[i]["error"] = e.what();
+    }
+  }
+  runner.run(CandleSpanIterator(*candles));
+  size_t finished = 0;
+  for (size_t k = 0; k < added.size(); k++) {
+    nlohmann::json& result = results[added[k]];
+    try {
+      if (auto error = runner.error(k)) {
+        std::rethrow_exception(error);
+      }
+      result["summary"] = engines[k]->stats().summary();
+      finished++;
+    } catch (const std::exception& e) {
+      result["error"] = e.what();
+    }
+  }
+  return candles->size() * finished;
+}
+
+int main(int argc, char** argv) {
+  std::string job_path =
+      argc > 1 ? argv[1] : PROJECT_ROOT_DIR "/.wedge/jobs.json";
+  std::ifstream job_file(job_path);
+  if (!job_file) {
+    fmt::print(stderr, "cannot open {}\n", job_path);
+    return 1;
+  }
+  nlohmann::json j;
+  job_file >> j;
+  auto config = j.get<JobFile>();
+
+  std::string output_path = PROJECT_ROOT_DIR "/" + config.output;
+  std::ofstream output(output_path);
+  if (!output) {
+    fmt::print(stderr, "cannot create {}\n", output_path);
+    return 1;
+  }
+  CandleCache cache(config.cached_datasets);
+  std::mutex output_mutex;
+  std::atomic<size_t> total_candles = 0;
+  std::atomic<size_t> failed = 0;
+
+  auto report = [&](const Job& job, nlohmann::json& result, double seconds) {
+    result["seconds"] = seconds;
+    std::lock_guard lock(output_mutex);
+    output << result.dump() << '\n' << std::flush;
+    if (result.contains("error")) {
+      failed++;
+      fmt::print("{}: {}\n", job.name, result["error"].get<std::string>());
+    } else {
+      const nlohmann::json& summary = result["summary"];
+      fmt::print("{}: equity {:.4f} return {:.2f}% in {:.2f}s\n", job.name,
+                 summary["final_equity"].get<double>(),
+                 summary["total_return"].get<double>() * 100, seconds);
+    }
+  };
+
+  // Jobs that only need the shared candles are grouped by (dataset, window).
+  using Window = std::tuple<std::string, std::string, std::string>;
+  std::map<Window, std::vector<const Job*>> groups;
+  std::vector<const Job*> singles;
+  for (const Job& job : config.jobs) {
+    if (job.start_time.empty() || job.end_time.empty()) {
+      nlohmann::json result = job;
+      result["error"] = "start_time and end_time are required";
+      report(job, result, 0);
+    } else if (job.sub_candles.empty() && job.checkpoint_days == 0) {
+      groups[{job.dataset, job.start_time, job.end_time}].push_back(&job);
+    } else {
+      singles.push_back(&job);
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  size_t threads = config.threads > 0 ? config.threads
+                                      : std::thread::hardware_concurrency();
+  // Groups run one at a time on every thread, so each block is read once
+  // and shared by all of them, then the rest go to the pool.
+  for (const auto& [window, jobs] : groups) {
+    if (jobs.size() == 1) {
+      singles.push_back(jobs.front());
+      continue;
+    }
+    auto group_start = std::chrono::steady_clock::now();
+    std::vector<nlohmann::json> results;
+    for (const Job* job : jobs) {
+      results.push_back(*job);
+    }
+    try {
+      total_candles += run_jobs(jobs, cache, results, threads);
+    } catch (const std::exception& e) {
+      for (nlohmann::json& result : results) {
+        result["error"] = e.what();
+      }
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - group_start;
+    for (size_t k = 0; k < jobs.size(); k++) {
+      report(*jobs[k], results[k], elapsed.count());
+    }
+  }
+  {
+    WorkStealingPool pool(threads);
+    for (const Job* job : singles) {
+      pool.submit([&, job] {
+        auto job_start = std::chrono::steady_clock::now();
+        nlohmann::json result = *job;
+        try {
+          total_candles += run_job(*job, cache, result);
+        } catch (const std::exception& e) {
+          result["error"] = e.what();
+        }
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - job_start;
+        report(*job, result, elapsed.count());
+      });
+    }
+    pool.wait();
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  double seconds = elapsed.count();
+  // Candles are counted once per job that finished, a group of N jobs over
+  // the same candles counts them N times, failed jobs count none.
+  fmt::print("{} jobs ({} failed) over {} candles on {} threads in {:.2f}s\n",
+             config.jobs.size(), failed.load(), total_candles.load(), threads,
+             seconds);
+  fmt::print("{:.2f} jobs/s, {:.0f} candles/s\n", config.jobs.size() / seconds,
+             total_candles.load() / seconds);
+  return failed == 0 ? 0 : 1;
+}
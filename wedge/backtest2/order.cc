@@ -2,75 +2,111 @@
 
 namespace wedge {
 
-void OrderBase::status(OrderStatus new_status) {
-  status_ = new_status;
-  if (new_status != OrderStatus::kFilled) {
-    return;
-  }
-  if (!triggered_.empty()) {
-    TriggerOrderEvent event{
-        .orders = triggered_,
-    };
-    listener_->on_event(event);
-  }
-  if (!canceled_.empty()) {
-    CancelOrderEvent event{
-        .orders = canceled_,
-    };
-    listener_->on_event(event);
+bool OrderBase::could_fill(const Candle& candle) const {
+  Trigger trigger = this->trigger();
+  switch (trigger.on) {
+    case TriggerOn::kLow:
+      return candle.low_price <= trigger.price;
+    case TriggerOn::kHigh:
+      return trigger.price <= candle.high_price;
+    case TriggerOn::kAny:
+      return true;
   }
+  return false;
 }
 
-void LimitOrder::update(const Candle& candle) {
-  if (side_ == OrderSide::kBuy && candle.low_price <= price_) {
-    FillOrderEvent event{
-        .side = OrderSide::kBuy,
-        .base = quantity_,
-        .quote = quantity_ * price_,
-    };
-    listener_->on_event(event);
-    this->status(OrderStatus::kFilled);
-  }
-  if (side_ == OrderSide::kSell && price_ <= candle.high_price) {
-    FillOrderEvent event{
-        .side = OrderSide::kSell,
-        .base = quantity_,
-        .quote = quantity_ * price_,
-    };
-    listener_->on_event(event);
-    this->status(OrderStatus::kFilled);
+void OrderBase::to_json(nlohmann::json& json) const {
+  json["side"] = side_;
+  json["status"] = status_;
+  json["triggered"] = triggered_;
+  json["canceled"] = canceled_;
+}
+
+void OrderBase::restore_links(const nlohmann::json& json) {
+  triggered_ = json["triggered"].get<std::vector<uint64_t>>();
+  canceled_ = json["canceled"].get<std::vector<uint64_t>>();
+}
+
+FillOrderEvent LimitOrder::fill(const Candle&) const {
+  return FillOrderEvent{
+      .order_id = 0,
+      .side = side_,
+      .base = quantity_,
+      .quote = quantity_ * price_,
+  };
+}
+
+Trigger LimitOrder::trigger() const {
+  if (side_ == OrderSide::kBuy) {
+    return Trigger{.on = TriggerOn::kLow, .price = price_};
   }
+  return Trigger{.on = TriggerOn::kHigh, .price = price_};
 }
 
-void MarketOrder::update(const Candle& candle) {
-  FillOrderEvent event{
+FillOrderEvent MarketOrder::fill(const Candle& candle) const {
+  return FillOrderEvent{
+      .order_id = 0,
       .side = side_,
       .base = quantity_,
       .quote = quantity_ * candle.close_price,
   };
-  listener_->on_event(event);
-  this->status(OrderStatus::kFilled);
 }
 
-void StopLossOrder::update(const Candle& candle) {
-  if (side_ == OrderSide::kSell && candle.low_price <= price_) {
-    FillOrderEvent event{
-        .side = OrderSide::kSell,
-        .base = quantity_,
-        .quote = quantity_ * price_,
-    };
-    listener_->on_event(event);
-    this->status(OrderStatus::kFilled);
+Trigger MarketOrder::trigger() const {
+  return Trigger{.on = TriggerOn::kAny, .price = 0};
+}
+
+FillOrderEvent StopLossOrder::fill(const Candle&) const {
+  return FillOrderEvent{
+      .order_id = 0,
+      .side = side_,
+      .base = quantity_,
+      .quote = quantity_ * price_,
+  };
+}
+
+Trigger StopLossOrder::trigger() const {
+  if (side_ == OrderSide::kSell) {
+    return Trigger{.on = TriggerOn::kLow, .price = price_};
   }
-  if (side_ == OrderSide::kBuy && price_ <= candle.high_price) {
-    FillOrderEvent event{
-        .side = OrderSide::kBuy,
-        .base = quantity_,
-        .quote = quantity_ * price_,
-    };
-    listener_->on_event(event);
-    this->status(OrderStatus::kFilled);
+  return Trigger{.on = TriggerOn::kHigh, .price = price_};
+}
+
+void LimitOrder::to_json(nlohmann::json& json) const {
+  OrderBase::to_json(json);
+  json["type"] = "limit";
+  json["price"] = price_;
+  json["quantity"] = quantity_;
+}
+
+void MarketOrder::to_json(nlohmann::json& json) const {
+  OrderBase::to_json(json);
+  json["type"] = "market";
+  json["quantity"] = quantity_;
+}
+
+void StopLossOrder::to_json(nlohmann::json& json) const {
+  OrderBase::to_json(json);
+  json["type"] = "stop_loss";
+  json["price"] = price_;
+  json["quantity"] = quantity_;
+}
+
+std::unique_ptr<OrderBase> order_from_json(const nlohmann::json& json) {
+  OrderSide side = json["side"];
+  OrderStatus status = json["status"];
+  double quantity = json["quantity"];
+  std::unique_ptr<OrderBase> order;
+  if (json["type"] == "limit") {
+    order = std::make_unique<LimitOrder>(side, json["price"], quantity, status);
+  } else if (json["type"] == "market") {
+    order = std::make_unique<MarketOrder>(side, quantity, status);
+  } else {
+    order = std::make_unique<StopLossOrder>(side, json["price"], quantity,
+                                            status);
   }
+  order->restore_links(json);
+  return order;
 }
 
-}  // namespace wedge
\ No newline at end of file
+}  // namespace wedge
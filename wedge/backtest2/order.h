@@ -1,5 +1,8 @@
 #pragma once
 
+#include <nlohmann/json.hpp>
+
+#include <memory>
 #include <span>
 #include <vector>
 
@@ -8,45 +11,48 @@
 
 namespace wedge {
 
+// A crossed order's fill, applied by the engine when it settles the candle.
 struct FillOrderEvent {
+  uint64_t order_id;
   OrderSide side;
   double base;
   double quote;
 };
 
-struct TriggerOrderEvent {
-  std::span<uint64_t> orders;
-};
+// Which end of a candle's range fills an order, kAny fills on every candle.
+enum class TriggerOn { kLow, kHigh, kAny };
 
-struct CancelOrderEvent {
-  std::span<uint64_t> orders;
-};
-
-class OrderListener {
- public:
-  virtual ~OrderListener() = default;
-  virtual void on_event(const FillOrderEvent& event) = 0;
-  virtual void on_event(const TriggerOrderEvent& event) = 0;
-  virtual void on_event(const CancelOrderEvent& event) = 0;
+struct Trigger {
+  TriggerOn on;
+  double price;
 };
 
 class OrderBase {
  public:
-  OrderBase(OrderListener* listener, OrderSide side, OrderStatus status)
-      : listener_(listener), side_(side), status_(status) {}
+  OrderBase(OrderSide side, OrderStatus status)
+      : side_(side), status_(status) {}
 
   virtual ~OrderBase() = default;
-  virtual void update(const Candle& candle) = 0;
+  // The fill of an order the candle crossed, order_id is left to the caller.
+  virtual FillOrderEvent fill(const Candle& candle) const = 0;
+  virtual Trigger trigger() const = 0;
+  // Whether the candle's range reaches this order's trigger price.
+  bool could_fill(const Candle& candle) const;
   OrderStatus status() const { return status_; }
   bool is_status(OrderStatus status) const { return status == status_; }
-  void status(OrderStatus status);
+  void status(OrderStatus status) { status_ = status; }
 
   void add_triggered(uint64_t order_id) { triggered_.push_back(order_id); }
+  std::span<const uint64_t> triggered() const { return triggered_; }
 
   void add_canceled(uint64_t order_id) { canceled_.push_back(order_id); }
+  std::span<const uint64_t> canceled() const { return canceled_; }
+
+  // Derived orders add their type and parameters, see order_from_json.
+  virtual void to_json(nlohmann::json& json) const;
+  void restore_links(const nlohmann::json& json);
 
  protected:
-  OrderListener* listener_;
   OrderSide side_;
 
  private:
@@ -57,10 +63,11 @@ class OrderBase {
 
 class LimitOrder final : public OrderBase {
  public:
-  LimitOrder(OrderListener* listener, OrderSide side, double price,
-             double quantity, OrderStatus status)
-      : OrderBase(listener, side, status), price_(price), quantity_(quantity) {}
-  void update(const Candle& candle) override;
+  LimitOrder(OrderSide side, double price, double quantity, OrderStatus status)
+      : OrderBase(side, status), price_(price), quantity_(quantity) {}
+  FillOrderEvent fill(const Candle& candle) const override;
+  Trigger trigger() const override;
+  void to_json(nlohmann::json& json) const override;
 
  private:
   double price_;
@@ -69,10 +76,11 @@ class LimitOrder final : public OrderBase {
 
 class MarketOrder final : public OrderBase {
  public:
-  MarketOrder(OrderListener* listener, OrderSide side, double quantity,
-              OrderStatus status)
-      : OrderBase(listener, side, status), quantity_(quantity) {}
-  void update(const Candle& candle) override;
+  MarketOrder(OrderSide side, double quantity, OrderStatus status)
+      : OrderBase(side, status), quantity_(quantity) {}
+  FillOrderEvent fill(const Candle& candle) const override;
+  Trigger trigger() const override;
+  void to_json(nlohmann::json& json) const override;
 
  private:
   double quantity_;
@@ -80,14 +88,18 @@ class MarketOrder final : public OrderBase {
 
 class StopLossOrder final : public OrderBase {
  public:
-  StopLossOrder(OrderListener* listener, OrderSide side, double price,
-                double quantity, OrderStatus status)
-      : OrderBase(listener, side, status), price_(price), quantity_(quantity) {}
-  void update(const Candle& candle) override;
+  StopLossOrder(OrderSide side, double price, double quantity,
+                OrderStatus status)
+      : OrderBase(side, status), price_(price), quantity_(quantity) {}
+  FillOrderEvent fill(const Candle& candle) const override;
+  Trigger trigger() const override;
+  void to_json(nlohmann::json& json) const override;
 
  private:
   double price_;
   double quantity_;
 };
 
-}  // namespace wedge
\ No newline at end of file
+std::unique_ptr<OrderBase> order_from_json(const nlohmann::json& json);
+
+}  // namespace wedge
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include "wedge/common/candle.h"
+
+namespace wedge {
+
+// 1m candles of the traded symbol, loaded on demand for the coarse candles
+// whose range could fill more than one order.
+class SubCandleSource {
+ public:
+  virtual ~SubCandleSource() = default;
+  // Candles with open_time in [start_time, end_time], returns the count.
+  virtual size_t load(int64_t start_time, int64_t end_time,
+                      std::span<Candle> candles) = 0;
+};
+
+// Works with any dataset whose iterator seeks by timestamp.
+template <class Dataset>
+class DatasetSubCandles final : public SubCandleSource {
+ public:
+  explicit DatasetSubCandles(Dataset* dataset) : dataset_(dataset) {}
+
+  size_t load(int64_t start_time, int64_t end_time,
+              std::span<Candle> candles) override {
+    return dataset_->iterator(start_time, end_time).next_batch(candles);
+  }
+
+ private:
+  Dataset* dataset_;
+};
+
+}  // namespace wedge
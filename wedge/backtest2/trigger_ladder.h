@@ -0,0 +1,106 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "wedge/backtest2/order.h"
+#include "wedge/backtest2/trigger_mask.h"
+#include "wedge/common/candle.h"
+
+namespace wedge {
+
+// Resting orders that fill at one end of the candle range, sorted so the
+// orders a candle reaches form a suffix. A candle costs a search plus the
+// orders it fills, however many orders rest below or above the market.
+//
+// Keys, sequences and order ids are kept in separate arrays, the search
+// only reads keys and finishes with one trigger_mask over the last block.
+class TriggerLadder {
+  static constexpr size_t kMaskBlock = 16;
+
+ public:
+  explicit TriggerLadder(TriggerOn on) : on_(on) {}
+
+  void insert(double price, uint64_t sequence, uint64_t order_id) {
+    double key = this->key(price);
+    size_t index = position(key, sequence + 1);
+    keys_.insert(keys_.begin() + index, key);
+    sequences_.insert(sequences_.begin() + index, sequence);
+    order_ids_.insert(order_ids_.begin() + index, order_id);
+  }
+
+  // Does nothing when the order was already popped.
+  void erase(double price, uint64_t sequence) {
+    double key = this->key(price);
+    size_t index = position(key, sequence);
+    if (index < keys_.size() && keys_[index] == key &&
+        sequences_[index] == sequence) {
+      keys_.erase(keys_.begin() + index);
+      sequences_.erase(sequences_.begin() + index);
+      order_ids_.erase(order_ids_.begin() + index);
+    }
+  }
+
+  // Number of orders the candle reaches, they are the last ones of
+  // sequences() and order_ids().
+  size_t crossed(const Candle& candle) const {
+    double threshold =
+        on_ == TriggerOn::kLow ? candle.low_price : -candle.high_price;
+    // Narrow down to a block where the suffix starts, then count it.
+    size_t first = 0;
+    size_t last = keys_.size();
+    while (last - first > kMaskBlock) {
+      size_t middle = first + (last - first) / 2;
+      if (keys_[middle] < threshold) {
+        first = middle + 1;
+      } else {
+        last = middle;
+      }
+    }
+    std::span<const double> block(keys_.data() + first, last - first);
+    return keys_.size() - last + std::popcount(trigger_mask(block, threshold));
+  }
+
+  std::span<const uint64_t> sequences() const { return sequences_; }
+  std::span<const uint64_t> order_ids() const { return order_ids_; }
+
+  // Removes the last `count` orders, the ones crossed() counted.
+  void pop(size_t count) {
+    keys_.resize(keys_.size() - count);
+    sequences_.resize(sequences_.size() - count);
+    order_ids_.resize(order_ids_.size() - count);
+  }
+
+  void clear() { pop(keys_.size()); }
+
+ private:
+  // The price, negated on a kHigh ladder so both ladders cross upwards.
+  double key(double price) const {
+    return on_ == TriggerOn::kLow ? price : -price;
+  }
+
+  // First index ordered at or after (key, sequence).
+  size_t position(double key, uint64_t sequence) const {
+    size_t first = 0;
+    size_t last = keys_.size();
+    while (first < last) {
+      size_t middle = first + (last - first) / 2;
+      if (keys_[middle] < key ||
+          (keys_[middle] == key && sequences_[middle] < sequence)) {
+        first = middle + 1;
+      } else {
+        last = middle;
+      }
+    }
+    return first;
+  }
+
+  TriggerOn on_;
+  std::vector<double> keys_;
+  std::vector<uint64_t> sequences_;
+  std::vector<uint64_t> order_ids_;
+};
+
+}  // namespace wedge
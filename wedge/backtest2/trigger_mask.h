@@ -0,0 +1,34 @@
+#pragma once
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include <cassert>
+#include <cstdint>
+#include <span>
+
+namespace wedge {
+
+// Bit i is set when keys[i] >= threshold, for at most 32 keys. Compiled to
+// AVX2 compares when the target has them, the scalar loop is the fallback
+// and handles the tail.
+inline uint32_t trigger_mask(std::span<const double> keys, double threshold) {
+  assert(keys.size() <= 32);
+  uint32_t mask = 0;
+  size_t i = 0;
+#ifdef __AVX2__
+  __m256d t = _mm256_set1_pd(threshold);
+  for (; i + 4 <= keys.size(); i += 4) {
+    __m256d k = _mm256_loadu_pd(keys.data() + i);
+    uint32_t bits = _mm256_movemask_pd(_mm256_cmp_pd(k, t, _CMP_GE_OQ));
+    mask |= bits << i;
+  }
+#endif
+  for (; i < keys.size(); i++) {
+    mask |= uint32_t(keys[i] >= threshold) << i;
+  }
+  return mask;
+}
+
+}  // namespace wedge
@@ -1,6 +1,11 @@
-
 target("wedge.backtest2", function () 
   set_kind("binary")
   add_files("*.cc")
+  remove_files("benchmark_strategy001.cc")
   add_deps("wedge.dataset")
-end)
\ No newline at end of file
+end)
+
+target("wedge.backtest2.benchmark", function () 
+  set_kind("binary")
+  add_files("backtest_engine.cc", "order.cc", "benchmark_strategy001.cc")
+end)
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <boost/asio.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace wedge {
+
+namespace asio = boost::asio;
+
+// Token bucket over the Binance request weight. All users must run on the
+// same executor, the limiter itself is not thread safe.
+class RateLimiter {
+  using Clock = std::chrono::steady_clock;
+
+ public:
+  explicit RateLimiter(int weight_per_minute)
+      : capacity_(weight_per_minute),
+        tokens_(weight_per_minute),
+        rate_(weight_per_minute / 60000.0),
+        last_refill_(Clock::now()) {}
+
+  asio::awaitable<void> acquire(int weight) {
+    auto executor = co_await asio::this_coro::executor;
+    for (;;) {
+      refill();
+      if (tokens_ >= weight) {
+        tokens_ -= weight;
+        co_return;
+      }
+      auto wait = std::chrono::milliseconds(
+          static_cast<int64_t>(std::ceil((weight - tokens_) / rate_)));
+      asio::steady_timer timer(executor, wait);
+      co_await timer.async_wait(asio::use_awaitable);
+    }
+  }
+
+  // Sync with the X-MBX-USED-WEIGHT-1M header, other clients on the same IP
+  // share the server side budget.
+  void update_used_weight(int used_weight) {
+    refill();
+    tokens_ = std::min(tokens_, capacity_ - used_weight);
+  }
+
+  // Drain the bucket after a 429/418 so nobody sends before Retry-After.
+  void back_off(std::chrono::seconds retry_after) {
+    refill();
+    tokens_ = std::min(tokens_, -rate_ * Milliseconds(retry_after).count());
+  }
+
+ private:
+  using Milliseconds = std::chrono::duration<double, std::milli>;
+
+  void refill() {
+    auto now = Clock::now();
+    double elapsed = Milliseconds(now - last_refill_).count();
+    tokens_ = std::min(capacity_, tokens_ + elapsed * rate_);
+    last_refill_ = now;
+  }
+
+  double capacity_;
+  double tokens_;
+  double rate_;
+  Clock::time_point last_refill_;
+};
+
+}  // namespace wedge
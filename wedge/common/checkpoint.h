@@ -0,0 +1,63 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <charconv>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace wedge {
+
+// Checkpoints are JSON files named after the close time of the last candle
+// they include, so the newest usable one is found from the directory listing.
+inline void write_checkpoint(const std::filesystem::path& directory,
+                             int64_t time, const nlohmann::json& json) {
+  std::filesystem::create_directories(directory);
+  auto path = directory / (std::to_string(time) + ".json");
+  // Jobs with the same parameters may write the same checkpoint at once.
+  size_t writer = std::hash<std::thread::id>()(std::this_thread::get_id());
+  auto temporary = path;
+  temporary += "." + std::to_string(writer) + ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::trunc);
+    file << json;
+  }
+  // A crash while writing never leaves a truncated checkpoint behind.
+  std::filesystem::rename(temporary, path);
+}
+
+// Latest checkpoint taken at or before `time`.
+inline std::optional<std::pair<int64_t, nlohmann::json>> latest_checkpoint(
+    const std::filesystem::path& directory, int64_t time) {
+  if (!std::filesystem::is_directory(directory)) {
+    return std::nullopt;
+  }
+  std::optional<int64_t> latest;
+  for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+    if (entry.path().extension() != ".json") {
+      continue;
+    }
+    std::string stem = entry.path().stem().string();
+    int64_t value;
+    auto [end, error] =
+        std::from_chars(stem.data(), stem.data() + stem.size(), value);
+    if (error != std::errc() || end != stem.data() + stem.size()) {
+      continue;
+    }
+    if (value <= time && (!latest || *latest < value)) {
+      latest = value;
+    }
+  }
+  if (!latest) {
+    return std::nullopt;
+  }
+  std::ifstream file(directory / (std::to_string(*latest) + ".json"));
+  return std::pair(*latest, nlohmann::json::parse(file));
+}
+
+}  // namespace wedge
@@ -1,6 +1,10 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
 
 namespace wedge {
 using TimePoint = std::chrono::system_clock::time_point;
@@ -10,4 +14,21 @@ using Hours = std::chrono::hours;
 using Milliseconds = std::chrono::milliseconds;
 using std::chrono::duration_cast;
 using namespace std::chrono_literals;
-}
\ No newline at end of file
+
+// "%Y-%m-%d" at 00:00 UTC, kline timestamps are UTC as well. Throws on
+// anything else.
+inline int64_t as_unix_timestamp(const std::string& time_str) {
+  int year = 1970;
+  unsigned month = 1;
+  unsigned day = 1;
+  if (std::sscanf(time_str.c_str(), "%d-%u-%u", &year, &month, &day) != 3) {
+    throw std::runtime_error("invalid date \"" + time_str + "\"");
+  }
+  std::chrono::year_month_day date{std::chrono::year(year) / month / day};
+  if (!date.ok()) {
+    throw std::runtime_error("invalid date \"" + time_str + "\"");
+  }
+  std::chrono::sys_days days{date};
+  return duration_cast<Milliseconds>(days.time_since_epoch()).count();
+}
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "wedge/common/enums.h"
+
+namespace wedge {
+
+struct EquityPoint {
+  int64_t time;
+  double equity;
+  NLOHMANN_DEFINE_TYPE_INTRUSIVE(EquityPoint, time, equity)
+};
+
+struct PerformanceSummary {
+  int64_t candles;
+  double initial_equity;
+  double final_equity;
+  double total_return;
+  // Largest peak to trough loss as a fraction of the peak.
+  double max_drawdown;
+  // Annualized from per-candle returns with the observed candle interval.
+  double sharpe;
+  double sortino;
+  // Traded notional divided by the initial equity.
+  double turnover;
+  double fees;
+  int64_t buy_fills;
+  int64_t sell_fills;
+  NLOHMANN_DEFINE_TYPE_INTRUSIVE(PerformanceSummary, candles, initial_equity,
+                                 final_equity, total_return, max_drawdown,
+                                 sharpe, sortino, turnover, fees, buy_fills,
+                                 sell_fills)
+};
+
+// Accumulates performance statistics in O(1) per candle and per fill, so a
+// backtest does not need to keep its equity curve or logs to be ranked.
+class PerformanceStats {
+ public:
+  // Keep one equity point per `interval_ms`, zero keeps none.
+  void sample_equity(int64_t interval_ms) { sample_interval_ = interval_ms; }
+
+  // `notional` and `fee` are in quote currency.
+  void on_fill(OrderSide side, double notional, double fee) {
+    if (side == OrderSide::kBuy) {
+      buy_fills_++;
+    } else {
+      sell_fills_++;
+    }
+    notional_ += notional;
+    fees_ += fee;
+  }
+
+  void on_candle(int64_t time, double equity) {
+    if (candles_++ == 0) {
+      first_time_ = time;
+      initial_equity_ = peak_ = equity;
+    } else if (previous_equity_ != 0) {
+      double r = equity / previous_equity_ - 1;
+      // Welford's update keeps the variance numerically stable.
+      double delta = r - mean_return_;
+      mean_return_ += delta / (candles_ - 1);
+      m2_ += delta * (r - mean_return_);
+      if (r < 0) {
+        downside_ += r * r;
+      }
+    }
+    peak_ = std::max(peak_, equity);
+    if (peak_ > 0) {
+      max_drawdown_ = std::max(max_drawdown_, (peak_ - equity) / peak_);
+    }
+    previous_equity_ = equity;
+    last_time_ = time;
+
+    if (sample_interval_ > 0 && time >= next_sample_) {
+      equity_.push_back(EquityPoint{.time = time, .equity = equity});
+      next_sample_ = time - time % sample_interval_ + sample_interval_;
+    }
+  }
+
+  std::span<const EquityPoint> equity_curve() const { return equity_; }
+
+  PerformanceSummary summary() const {
+    PerformanceSummary result{
+        .candles = candles_,
+        .initial_equity = initial_equity_,
+        .final_equity = previous_equity_,
+        .total_return = 0,
+        .max_drawdown = max_drawdown_,
+        .sharpe = 0,
+        .sortino = 0,
+        .turnover = 0,
+        .fees = fees_,
+        .buy_fills = buy_fills_,
+        .sell_fills = sell_fills_,
+    };
+    if (initial_equity_ != 0) {
+      result.total_return = previous_equity_ / initial_equity_ - 1;
+      result.turnover = notional_ / initial_equity_;
+    }
+    int64_t returns = candles_ - 1;
+    if (returns < 2 || last_time_ <= first_time_) {
+      return result;
+    }
+    constexpr double kYearMs = 365.25 * 24 * 60 * 60 * 1000;
+    double interval = double(last_time_ - first_time_) / returns;
+    double annualize = std::sqrt(kYearMs / interval);
+    double deviation = std::sqrt(m2_ / (returns - 1));
+    double downside = std::sqrt(downside_ / returns);
+    if (deviation > 0) {
+      result.sharpe = mean_return_ / deviation * annualize;
+    }
+    if (downside > 0) {
+      result.sortino = mean_return_ / downside * annualize;
+    }
+    return result;
+  }
+
+ private:
+  int64_t candles_ = 0;
+  int64_t first_time_ = 0;
+  int64_t last_time_ = 0;
+  double initial_equity_ = 0;
+  double previous_equity_ = 0;
+  double peak_ = 0;
+  double max_drawdown_ = 0;
+  double mean_return_ = 0;
+  double m2_ = 0;
+  double downside_ = 0;
+  double notional_ = 0;
+  double fees_ = 0;
+  int64_t buy_fills_ = 0;
+  int64_t sell_fills_ = 0;
+
+  int64_t sample_interval_ = 0;
+  int64_t next_sample_ = 0;
+  std::vector<EquityPoint> equity_;
+
+  NLOHMANN_DEFINE_TYPE_INTRUSIVE(PerformanceStats, candles_, first_time_,
+                                 last_time_, initial_equity_, previous_equity_,
+                                 peak_, max_drawdown_, mean_return_, m2_,
+                                 downside_, notional_, fees_, buy_fills_,
+                                 sell_fills_, sample_interval_, next_sample_,
+                                 equity_)
+};
+
+}  // namespace wedge
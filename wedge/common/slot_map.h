@@ -0,0 +1,111 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace wedge {
+
+// Ids pack the slot in the low 32 bits and the slot's generation in the high
+// 32 bits. A slot's generation is bumped when it is erased, so ids of erased
+// values never match the value that later reuses the slot.
+inline uint32_t slot_of(uint64_t id) { return static_cast<uint32_t>(id); }
+inline uint32_t generation_of(uint64_t id) { return id >> 32; }
+
+// Storage whose size follows the number of live values rather than the
+// number ever inserted. Recycled slots keep the value erase left in them,
+// so containers can be cleared instead of freed and reuse their capacity.
+template <class T>
+class SlotMap {
+  struct Slot {
+    T value{};
+    uint32_t generation = 0;
+    bool live = false;
+  };
+
+ public:
+  uint64_t allocate() {
+    uint32_t slot;
+    if (free_.empty()) {
+      slot = static_cast<uint32_t>(slots_.size());
+      slots_.emplace_back();
+    } else {
+      slot = free_.back();
+      free_.pop_back();
+    }
+    slots_[slot].live = true;
+    size_++;
+    return uint64_t(slots_[slot].generation) << 32 | slot;
+  }
+
+  // The caller resets the value, the slot only becomes reusable.
+  void erase(uint64_t id) {
+    Slot& slot = slots_[slot_of(id)];
+    slot.live = false;
+    slot.generation++;
+    free_.push_back(slot_of(id));
+    size_--;
+  }
+
+  bool contains(uint64_t id) const {
+    uint32_t slot = slot_of(id);
+    return slot < slots_.size() && slots_[slot].live &&
+           slots_[slot].generation == generation_of(id);
+  }
+
+  // `id` must be live.
+  T& operator[](uint64_t id) { return slots_[slot_of(id)].value; }
+  const T& operator[](uint64_t id) const { return slots_[slot_of(id)].value; }
+
+  size_t size() const { return size_; }
+
+  template <class F>
+  void for_each(F&& f) const {
+    for (uint32_t i = 0; i < slots_.size(); i++) {
+      if (slots_[i].live) {
+        f(uint64_t(slots_[i].generation) << 32 | i, slots_[i].value);
+      }
+    }
+  }
+
+  // Keeps slots and generations, so ids handed out before a checkpoint stay
+  // valid after it is restored.
+  template <class F>
+  void to_json(nlohmann::json& json, F&& value_to_json) const {
+    json["generations"] = nlohmann::json::array();
+    json["values"] = nlohmann::json::array();
+    for (const Slot& slot : slots_) {
+      json["generations"].push_back(slot.generation);
+      nlohmann::json& value = json["values"].emplace_back(nullptr);
+      if (slot.live) {
+        value_to_json(slot.value, value);
+      }
+    }
+    json["free"] = free_;
+  }
+
+  template <class F>
+  void from_json(const nlohmann::json& json, F&& value_from_json) {
+    const nlohmann::json& values = json["values"];
+    slots_.clear();
+    slots_.resize(values.size());
+    size_ = 0;
+    for (size_t i = 0; i < slots_.size(); i++) {
+      slots_[i].generation = json["generations"][i];
+      slots_[i].live = !values[i].is_null();
+      if (slots_[i].live) {
+        value_from_json(values[i], slots_[i].value);
+        size_++;
+      }
+    }
+    free_ = json["free"].get<std::vector<uint32_t>>();
+  }
+
+ private:
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> free_;
+  size_t size_ = 0;
+};
+
+}  // namespace wedge
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace wedge {
+
+// Fixed-size thread pool where every worker owns a task deque. A worker pops
+// its own newest task and, once that runs dry, steals the oldest task of
+// another worker, so uneven task lengths still keep every core busy.
+class WorkStealingPool {
+  using Task = std::function<void()>;
+
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+ public:
+  explicit WorkStealingPool(
+      size_t thread_count = std::thread::hardware_concurrency()) {
+    thread_count = std::max<size_t>(thread_count, 1);
+    for (size_t i = 0; i < thread_count; i++) {
+      workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < thread_count; i++) {
+      threads_.emplace_back([this, i] { work(i); });
+    }
+  }
+
+  ~WorkStealingPool() {
+    {
+      std::lock_guard lock(mutex_);
+      stopped_ = true;
+    }
+    available_.notify_all();
+    for (std::thread& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  size_t size() const { return workers_.size(); }
+
+  void submit(Task task) {
+    Worker& worker = *workers_[next_worker_++ % workers_.size()];
+    {
+      std::lock_guard lock(worker.mutex);
+      worker.tasks.push_back(std::move(task));
+    }
+    {
+      std::lock_guard lock(mutex_);
+      queued_++;
+      pending_++;
+    }
+    available_.notify_one();
+  }
+
+  // Blocks until every submitted task has finished.
+  void wait() {
+    std::unique_lock lock(mutex_);
+    idle_.wait(lock, [&] { return pending_ == 0; });
+  }
+
+ private:
+  std::optional<Task> take(size_t self) {
+    for (size_t i = 0; i < workers_.size(); i++) {
+      Worker& worker = *workers_[(self + i) % workers_.size()];
+      std::unique_lock lock(worker.mutex);
+      if (worker.tasks.empty()) {
+        continue;
+      }
+      Task task;
+      if (i == 0) {
+        task = std::move(worker.tasks.back());
+        worker.tasks.pop_back();
+      } else {
+        task = std::move(worker.tasks.front());
+        worker.tasks.pop_front();
+      }
+      lock.unlock();
+      std::lock_guard count_lock(mutex_);
+      queued_--;
+      return task;
+    }
+    return std::nullopt;
+  }
+
+  void work(size_t self) {
+    for (;;) {
+      if (auto task = take(self)) {
+        (*task)();
+        std::lock_guard lock(mutex_);
+        if (--pending_ == 0) {
+          idle_.notify_all();
+        }
+        continue;
+      }
+      std::unique_lock lock(mutex_);
+      available_.wait(lock, [&] { return stopped_ || queued_ > 0; });
+      if (stopped_ && queued_ == 0) {
+        return;
+      }
+    }
+  }
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+  std::atomic<size_t> next_worker_ = 0;
+  size_t queued_ = 0;
+  size_t pending_ = 0;
+  bool stopped_ = false;
+  std::mutex mutex_;
+  std::condition_variable available_;
+  std::condition_variable idle_;
+};
+
+}  // namespace wedge
@@ -0,0 +1,210 @@
+#include "wedge/dataset/column_dataset.h"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+
+#include "wedge/common/chrono.h"
+
+namespace wedge {
+
+namespace bip = boost::interprocess;
+
+struct ColumnSpec {
+  const char* name;
+  ColumnType type;
+};
+
+static constexpr ColumnSpec kColumns[kCandleColumnCount] = {
+    {"open_time", ColumnType::kInt64},
+    {"close_time", ColumnType::kInt64},
+    {"open_price", ColumnType::kDouble},
+    {"close_price", ColumnType::kDouble},
+    {"high_price", ColumnType::kDouble},
+    {"low_price", ColumnType::kDouble},
+    {"volume", ColumnType::kDouble},
+    {"quote_volume", ColumnType::kDouble},
+    {"traders", ColumnType::kInt32},
+    {"taker_buy_base", ColumnType::kDouble},
+    {"taker_buy_quote", ColumnType::kDouble},
+};
+
+static std::string column_path(const std::string& path, int column) {
+  return fmt::format("{}/{}.col", path, kColumns[column].name);
+}
+
+static std::string zone_path(const std::string& path) {
+  return fmt::format("{}/zones.col", path);
+}
+
+static size_t column_width(ColumnType type) {
+  switch (type) {
+    case ColumnType::kInt32:
+      return sizeof(int32_t);
+    case ColumnType::kInt64:
+    case ColumnType::kDouble:
+      return sizeof(int64_t);
+    case ColumnType::kZone:
+      return sizeof(Zone);
+  }
+  return 0;
+}
+
+static void write_header(std::ofstream& file, ColumnType type,
+                         uint64_t count) {
+  ColumnHeader header{
+      .magic = kColumnMagic,
+      .version = kColumnVersion,
+      .type = type,
+      .count = count,
+  };
+  file.seekp(0);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+Column::Column(const std::string& path, ColumnType type)
+    : file_(path.c_str(), bip::read_only),
+      region_(file_, bip::read_only) {
+  if (region_.get_size() < sizeof(ColumnHeader)) {
+    throw std::runtime_error("truncated column file " + path);
+  }
+  auto header = static_cast<const ColumnHeader*>(region_.get_address());
+  if (header->magic != kColumnMagic || header->version != kColumnVersion ||
+      header->type != type) {
+    throw std::runtime_error("invalid column file " + path);
+  }
+  size_ = header->count;
+  if (region_.get_size() < sizeof(ColumnHeader) + size_ * column_width(type)) {
+    throw std::runtime_error("truncated column file " + path);
+  }
+}
+
+ColumnDataset::ColumnDataset(const std::string& path) {
+  for (int i = 0; i < kCandleColumnCount; i++) {
+    columns_[i].emplace(column_path(path, i), kColumns[i].type);
+  }
+  size_ = columns_[0]->size();
+  for (auto& column : columns_) {
+    if (column->size() != size_) {
+      throw std::runtime_error("column size mismatch in " + path);
+    }
+  }
+  candles_ = CandleColumns{
+      .open_time = columns_[0]->data<int64_t>(),
+      .close_time = columns_[1]->data<int64_t>(),
+      .open_price = columns_[2]->data<double>(),
+      .close_price = columns_[3]->data<double>(),
+      .high_price = columns_[4]->data<double>(),
+      .low_price = columns_[5]->data<double>(),
+      .volume = columns_[6]->data<double>(),
+      .quote_volume = columns_[7]->data<double>(),
+      .traders = columns_[8]->data<int32_t>(),
+      .taker_buy_base = columns_[9]->data<double>(),
+      .taker_buy_quote = columns_[10]->data<double>(),
+  };
+
+  // Datasets written before zone maps existed get theirs built on load.
+  if (std::filesystem::exists(zone_path(path))) {
+    Column zones(zone_path(path), ColumnType::kZone);
+    zones_.assign(zones.data<Zone>(), zones.data<Zone>() + zones.size());
+    return;
+  }
+  for (size_t i = 0; i < size_; i++) {
+    if (i % kZoneBlockSize == 0) {
+      zones_.push_back(Zone::of(candles_.at(i)));
+    }
+    zones_.back().extend(candles_.at(i));
+  }
+}
+
+size_t ColumnDataset::query(const CandleQuery& query,
+                            std::vector<Candle>& result) const {
+  size_t old_size = result.size();
+  for (size_t i = seek_zone(zones_, query.start_time); i < zones_.size(); i++) {
+    if (zones_[i].min_open_time > query.end_time) {
+      break;
+    }
+    if (!query.may_match(zones_[i])) {
+      continue;
+    }
+    size_t end = std::min(size_, (i + 1) * kZoneBlockSize);
+    for (size_t row = i * kZoneBlockSize; row < end; row++) {
+      Candle candle = candles_.at(row);
+      if (query.matches(candle)) {
+        result.push_back(candle);
+      }
+    }
+  }
+  return result.size() - old_size;
+}
+
+ColumnIterator ColumnDataset::iterator(
+    std::optional<std::string> start_time,
+    std::optional<std::string> end_time) const {
+  int64_t start_timestamp = 0;
+  int64_t end_timestamp = std::numeric_limits<int64_t>::max();
+  if (start_time) {
+    start_timestamp = as_unix_timestamp(*start_time);
+  }
+  if (end_time) {
+    end_timestamp = as_unix_timestamp(*end_time);
+  }
+  return iterator(start_timestamp, end_timestamp);
+}
+
+ColumnIterator ColumnDataset::iterator(int64_t start_time,
+                                       int64_t end_time) const {
+  const int64_t* first = candles_.open_time;
+  const int64_t* last = candles_.open_time + size_;
+  size_t begin = std::lower_bound(first, last, start_time) - first;
+  size_t end = std::upper_bound(first, last, end_time) - first;
+  return ColumnIterator(candles_, begin, std::max(begin, end));
+}
+
+ColumnWriter::ColumnWriter(const std::string& path) {
+  std::filesystem::create_directories(path);
+  for (int i = 0; i < kCandleColumnCount; i++) {
+    files_[i].open(column_path(path, i), std::ios::binary | std::ios::trunc);
+    if (!files_[i]) {
+      throw std::runtime_error("cannot create " + column_path(path, i));
+    }
+    ColumnHeader header{};
+    files_[i].write(reinterpret_cast<const char*>(&header), sizeof(header));
+  }
+  zone_file_.open(zone_path(path), std::ios::binary | std::ios::trunc);
+  if (!zone_file_) {
+    throw std::runtime_error("cannot create " + zone_path(path));
+  }
+}
+
+ColumnWriter::~ColumnWriter() {
+  for (int i = 0; i < kCandleColumnCount; i++) {
+    write_header(files_[i], kColumns[i].type, count_);
+  }
+  write_header(zone_file_, ColumnType::kZone, zones_.size());
+  zone_file_.write(reinterpret_cast<const char*>(zones_.data()),
+                   zones_.size() * sizeof(Zone));
+}
+
+void ColumnWriter::append(const Candle& candle) {
+  write(0, candle.open_time);
+  write(1, candle.close_time);
+  write(2, candle.open_price);
+  write(3, candle.close_price);
+  write(4, candle.high_price);
+  write(5, candle.low_price);
+  write(6, candle.volume);
+  write(7, candle.quote_volume);
+  write(8, static_cast<int32_t>(candle.traders));
+  write(9, candle.taker_buy_base);
+  write(10, candle.taker_buy_quote);
+  if (count_++ % kZoneBlockSize == 0) {
+    zones_.push_back(Zone::of(candle));
+  }
+  zones_.back().extend(candle);
+}
+
+}  // namespace wedge
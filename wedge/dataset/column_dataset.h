@@ -0,0 +1,170 @@
+#pragma once
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "wedge/common/candle.h"
+#include "wedge/dataset/zone_map.h"
+
+namespace wedge {
+
+enum class ColumnType : uint32_t {
+  kInt32,
+  kInt64,
+  kDouble,
+  kZone,
+};
+
+// Every column file starts with this header, the values follow it densely.
+// The header is 64 bytes so the values stay cache line aligned.
+struct ColumnHeader {
+  uint32_t magic;
+  uint32_t version;
+  ColumnType type;
+  uint32_t reserved;
+  uint64_t count;
+  uint8_t padding[40];
+};
+
+static_assert(sizeof(ColumnHeader) == 64);
+
+inline constexpr uint32_t kColumnMagic = 0x4c4f4357;  // "WCOL"
+inline constexpr uint32_t kColumnVersion = 1;
+inline constexpr int kCandleColumnCount = 11;
+
+class Column {
+ public:
+  Column(const std::string& path, ColumnType type);
+
+  template <class T>
+  const T* data() const {
+    auto address = static_cast<const char*>(region_.get_address());
+    return reinterpret_cast<const T*>(address + sizeof(ColumnHeader));
+  }
+
+  size_t size() const { return size_; }
+
+ private:
+  boost::interprocess::file_mapping file_;
+  boost::interprocess::mapped_region region_;
+  size_t size_;
+};
+
+struct CandleColumns {
+  const int64_t* open_time;
+  const int64_t* close_time;
+  const double* open_price;
+  const double* close_price;
+  const double* high_price;
+  const double* low_price;
+  const double* volume;
+  const double* quote_volume;
+  const int32_t* traders;
+  const double* taker_buy_base;
+  const double* taker_buy_quote;
+
+  Candle at(size_t index) const {
+    return Candle{
+        .open_time = open_time[index],
+        .close_time = close_time[index],
+        .open_price = open_price[index],
+        .close_price = close_price[index],
+        .high_price = high_price[index],
+        .low_price = low_price[index],
+        .volume = volume[index],
+        .quote_volume = quote_volume[index],
+        .traders = traders[index],
+        .taker_buy_base = taker_buy_base[index],
+        .taker_buy_quote = taker_buy_quote[index],
+    };
+  }
+};
+
+class ColumnIterator {
+ public:
+  ColumnIterator(const CandleColumns& columns, size_t begin, size_t end)
+      : columns_(columns), index_(begin), end_(end) {}
+
+  std::optional<Candle> next() {
+    if (index_ == end_) {
+      return std::nullopt;
+    }
+    return columns_.at(index_++);
+  }
+
+  size_t next_batch(std::span<Candle> candles) {
+    size_t count = std::min(candles.size(), end_ - index_);
+    for (size_t i = 0; i < count; i++) {
+      candles[i] = columns_.at(index_ + i);
+    }
+    index_ += count;
+    return count;
+  }
+
+ private:
+  CandleColumns columns_;
+  size_t index_;
+  size_t end_;
+};
+
+// A directory with one memory mapped file per candle field, plus a zone map
+// over every kZoneBlockSize rows.
+class ColumnDataset {
+ public:
+  explicit ColumnDataset(const std::string& path);
+
+  ColumnDataset(const ColumnDataset&) = delete;
+  ColumnDataset& operator=(const ColumnDataset&) = delete;
+
+  ColumnIterator iterator(std::optional<std::string> start_time = {},
+                          std::optional<std::string> end_time = {}) const;
+  // Candles with open_time in [start_time, end_time].
+  ColumnIterator iterator(int64_t start_time, int64_t end_time) const;
+
+  // Appends the matching candles to `result`, returns how many were added.
+  size_t query(const CandleQuery& query, std::vector<Candle>& result) const;
+
+  const CandleColumns& columns() const { return candles_; }
+  std::span<const Zone> zones() const { return zones_; }
+  size_t size() const { return size_; }
+
+ private:
+  std::array<std::optional<Column>, kCandleColumnCount> columns_;
+  CandleColumns candles_;
+  std::vector<Zone> zones_;
+  size_t size_;
+};
+
+class ColumnWriter {
+ public:
+  explicit ColumnWriter(const std::string& path);
+
+  ColumnWriter(const ColumnWriter&) = delete;
+  ColumnWriter& operator=(const ColumnWriter&) = delete;
+
+  ~ColumnWriter();
+
+  void append(const Candle& candle);
+
+ private:
+  template <class T>
+  void write(int column, T value) {
+    files_[column].write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  std::array<std::ofstream, kCandleColumnCount> files_;
+  std::ofstream zone_file_;
+  std::vector<Zone> zones_;
+  uint64_t count_ = 0;
+};
+
+}  // namespace wedge
@@ -0,0 +1,327 @@
+#include "wedge/dataset/compressed_dataset.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+#include "wedge/common/chrono.h"
+#include "wedge/dataset/encoding.h"
+
+namespace wedge {
+
+namespace bip = boost::interprocess;
+
+struct DoubleField {
+  double Candle::*member;
+  bool delta;
+};
+
+static constexpr DoubleField kDoubleFields[] = {
+    {&Candle::open_price, true},      {&Candle::close_price, true},
+    {&Candle::high_price, true},      {&Candle::low_price, true},
+    {&Candle::volume, false},         {&Candle::quote_volume, false},
+    {&Candle::taker_buy_base, false}, {&Candle::taker_buy_quote, false},
+};
+
+static constexpr double kPowers[] = {1e0, 1e1, 1e2, 1e3, 1e4,
+                                     1e5, 1e6, 1e7, 1e8};
+static constexpr uint8_t kRawDoubles = 0xff;
+
+// Smallest decimal exponent whose fixed point represents every value of the
+// field exactly, or -1 if there is none.
+static int decimal_exponent(std::span<const Candle> candles,
+                            double Candle::*member) {
+  for (int exponent = 0; exponent < std::ssize(kPowers); exponent++) {
+    double scale = kPowers[exponent];
+    bool exact = std::all_of(candles.begin(), candles.end(), [&](auto& c) {
+      double fixed = std::nearbyint(c.*member * scale);
+      return std::abs(fixed) < 0x1p53 && fixed / scale == c.*member;
+    });
+    if (exact) {
+      return exponent;
+    }
+  }
+  return -1;
+}
+
+static void encode_doubles(std::span<const Candle> candles,
+                           const DoubleField& field, std::string& out) {
+  int exponent = decimal_exponent(candles, field.member);
+  if (exponent < 0) {
+    out.push_back(static_cast<char>(kRawDoubles));
+    for (const Candle& candle : candles) {
+      put_raw(out, candle.*field.member);
+    }
+    return;
+  }
+
+  out.push_back(static_cast<char>(exponent));
+  double scale = kPowers[exponent];
+  int64_t previous = 0;
+  for (const Candle& candle : candles) {
+    double value = candle.*field.member;
+    auto fixed = static_cast<int64_t>(std::nearbyint(value * scale));
+    put_varint(out, zigzag_encode(fixed - previous));
+    if (field.delta) {
+      previous = fixed;
+    }
+  }
+}
+
+static void decode_doubles(const uint8_t*& in, const DoubleField& field,
+                           std::span<Candle> candles) {
+  uint8_t mode = *in++;
+  if (mode == kRawDoubles) {
+    for (Candle& candle : candles) {
+      candle.*field.member = get_raw<double>(in);
+    }
+    return;
+  }
+
+  double scale = kPowers[mode];
+  int64_t previous = 0;
+  for (Candle& candle : candles) {
+    int64_t fixed = zigzag_decode(get_varint(in)) + previous;
+    candle.*field.member = fixed / scale;
+    if (field.delta) {
+      previous = fixed;
+    }
+  }
+}
+
+void encode_block(std::span<const Candle> candles, std::string& out) {
+  put_raw(out, static_cast<uint32_t>(candles.size()));
+  if (candles.empty()) {
+    return;
+  }
+
+  put_raw(out, candles[0].open_time);
+  int64_t previous_delta = 0;
+  for (size_t i = 1; i < candles.size(); i++) {
+    int64_t delta = candles[i].open_time - candles[i - 1].open_time;
+    put_varint(out, zigzag_encode(delta - previous_delta));
+    previous_delta = delta;
+  }
+
+  int64_t previous_span = 0;
+  for (const Candle& candle : candles) {
+    int64_t span = candle.close_time - candle.open_time;
+    put_varint(out, zigzag_encode(span - previous_span));
+    previous_span = span;
+  }
+
+  for (const DoubleField& field : kDoubleFields) {
+    encode_doubles(candles, field, out);
+  }
+
+  for (const Candle& candle : candles) {
+    put_varint(out, zigzag_encode(candle.traders));
+  }
+}
+
+size_t decode_block(const uint8_t* in, std::span<Candle> candles) {
+  size_t count = get_raw<uint32_t>(in);
+  if (count == 0) {
+    return 0;
+  }
+  candles = candles.first(count);
+
+  int64_t open_time = get_raw<int64_t>(in);
+  int64_t delta = 0;
+  candles[0].open_time = open_time;
+  for (size_t i = 1; i < count; i++) {
+    delta += zigzag_decode(get_varint(in));
+    open_time += delta;
+    candles[i].open_time = open_time;
+  }
+
+  int64_t span = 0;
+  for (Candle& candle : candles) {
+    span += zigzag_decode(get_varint(in));
+    candle.close_time = candle.open_time + span;
+  }
+
+  for (const DoubleField& field : kDoubleFields) {
+    decode_doubles(in, field, candles);
+  }
+
+  for (Candle& candle : candles) {
+    candle.traders = static_cast<int>(zigzag_decode(get_varint(in)));
+  }
+  return count;
+}
+
+CompressedDataset::CompressedDataset(const std::string& path)
+    : file_(path.c_str(), bip::read_only), region_(file_, bip::read_only) {
+  base_ = static_cast<const uint8_t*>(region_.get_address());
+  if (region_.get_size() < sizeof(CompressedHeader)) {
+    throw std::runtime_error("truncated compressed file " + path);
+  }
+  auto header = reinterpret_cast<const CompressedHeader*>(base_);
+  if (header->magic != kCompressedMagic ||
+      header->version != kCompressedVersion ||
+      header->block_size != kCompressedBlockSize) {
+    throw std::runtime_error("invalid compressed file " + path);
+  }
+  size_t index_size = header->block_count * sizeof(BlockInfo);
+  if (region_.get_size() < header->index_offset + index_size) {
+    throw std::runtime_error("truncated compressed file " + path);
+  }
+  blocks_.resize(header->block_count);
+  std::memcpy(blocks_.data(), base_ + header->index_offset, index_size);
+  for (const BlockInfo& block : blocks_) {
+    zones_.push_back(block.zone);
+  }
+  size_ = header->candle_count;
+}
+
+size_t CompressedDataset::query(const CandleQuery& query,
+                                std::vector<Candle>& result) const {
+  size_t old_size = result.size();
+  std::vector<Candle> buffer(kCompressedBlockSize);
+  for (size_t i = seek_zone(zones_, query.start_time); i < zones_.size(); i++) {
+    if (zones_[i].min_open_time > query.end_time) {
+      break;
+    }
+    if (!query.may_match(zones_[i])) {
+      continue;
+    }
+    size_t count = decode_block(i, buffer);
+    std::copy_if(buffer.begin(), buffer.begin() + count,
+                 std::back_inserter(result),
+                 [&](const Candle& candle) { return query.matches(candle); });
+  }
+  return result.size() - old_size;
+}
+
+size_t CompressedDataset::decode_block(size_t index,
+                                       std::span<Candle> candles) const {
+  return wedge::decode_block(base_ + blocks_[index].offset, candles);
+}
+
+CompressedIterator CompressedDataset::iterator(
+    std::optional<std::string> start_time,
+    std::optional<std::string> end_time) const {
+  int64_t start_timestamp = 0;
+  int64_t end_timestamp = std::numeric_limits<int64_t>::max();
+  if (start_time) {
+    start_timestamp = as_unix_timestamp(*start_time);
+  }
+  if (end_time) {
+    end_timestamp = as_unix_timestamp(*end_time);
+  }
+  return iterator(start_timestamp, end_timestamp);
+}
+
+CompressedIterator CompressedDataset::iterator(int64_t start_time,
+                                               int64_t end_time) const {
+  return CompressedIterator(this, start_time, end_time);
+}
+
+bool CompressedIterator::fill() {
+  while (!done_ && block_ < dataset_->block_count()) {
+    if (dataset_->zones()[block_].min_open_time > end_time_) {
+      break;
+    }
+    size_t count = dataset_->decode_block(block_++, buffer_);
+    auto first = buffer_.begin();
+    auto last = buffer_.begin() + count;
+    auto lower = std::lower_bound(first, last, start_time_,
+                                  [](const Candle& candle, int64_t time) {
+                                    return candle.open_time < time;
+                                  });
+    auto upper = std::upper_bound(lower, last, end_time_,
+                                  [](int64_t time, const Candle& candle) {
+                                    return time < candle.open_time;
+                                  });
+    if (upper != last) {
+      done_ = true;
+    }
+    if (lower != upper) {
+      index_ = lower - first;
+      end_ = upper - first;
+      return true;
+    }
+  }
+  return false;
+}
+
+std::optional<Candle> CompressedIterator::next() {
+  if (index_ == end_ && !fill()) {
+    return std::nullopt;
+  }
+  return buffer_[index_++];
+}
+
+size_t CompressedIterator::next_batch(std::span<Candle> candles) {
+  size_t count = 0;
+  while (count < candles.size()) {
+    if (index_ == end_ && !fill()) {
+      break;
+    }
+    size_t n = std::min(candles.size() - count, end_ - index_);
+    std::copy_n(buffer_.begin() + index_, n, candles.begin() + count);
+    index_ += n;
+    count += n;
+  }
+  return count;
+}
+
+CompressedWriter::CompressedWriter(const std::string& path)
+    : file_(path, std::ios::binary | std::ios::trunc) {
+  if (!file_) {
+    throw std::runtime_error("cannot create " + path);
+  }
+  CompressedHeader header{};
+  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  pending_.reserve(kCompressedBlockSize);
+}
+
+CompressedWriter::~CompressedWriter() {
+  flush();
+  CompressedHeader header{
+      .magic = kCompressedMagic,
+      .version = kCompressedVersion,
+      .block_size = kCompressedBlockSize,
+      .candle_count = count_,
+      .block_count = blocks_.size(),
+      .index_offset = offset_,
+  };
+  file_.write(reinterpret_cast<const char*>(blocks_.data()),
+              blocks_.size() * sizeof(BlockInfo));
+  file_.seekp(0);
+  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void CompressedWriter::append(const Candle& candle) {
+  pending_.push_back(candle);
+  count_++;
+  if (pending_.size() == kCompressedBlockSize) {
+    flush();
+  }
+}
+
+void CompressedWriter::flush() {
+  if (pending_.empty()) {
+    return;
+  }
+  buffer_.clear();
+  encode_block(pending_, buffer_);
+  Zone zone = Zone::of(pending_.front());
+  for (const Candle& candle : pending_) {
+    zone.extend(candle);
+  }
+  blocks_.push_back(BlockInfo{
+      .offset = offset_,
+      .count = static_cast<uint32_t>(pending_.size()),
+      .zone = zone,
+  });
+  file_.write(buffer_.data(), buffer_.size());
+  offset_ += buffer_.size();
+  pending_.clear();
+}
+
+}  // namespace wedge
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "wedge/common/candle.h"
+#include "wedge/dataset/zone_map.h"
+
+namespace wedge {
+
+// File layout: header, encoded blocks back to back, then one BlockInfo per
+// block at index_offset.
+struct CompressedHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t block_size;
+  uint32_t reserved;
+  uint64_t candle_count;
+  uint64_t block_count;
+  uint64_t index_offset;
+  uint8_t padding[24];
+};
+
+static_assert(sizeof(CompressedHeader) == 64);
+
+struct BlockInfo {
+  uint64_t offset;
+  uint32_t count;
+  uint32_t reserved;
+  Zone zone;
+};
+
+inline constexpr uint32_t kCompressedMagic = 0x504d4357;  // "WCMP"
+inline constexpr uint32_t kCompressedVersion = 2;
+inline constexpr uint32_t kCompressedBlockSize = kZoneBlockSize;
+
+// Timestamps are stored as delta-of-delta, prices as deltas of the smallest
+// decimal fixed point that round trips exactly, volumes as plain fixed point.
+// Values that do not fit a fixed point fall back to raw doubles.
+void encode_block(std::span<const Candle> candles, std::string& out);
+
+// `candles` must have room for the whole block, returns the candle count.
+size_t decode_block(const uint8_t* data, std::span<Candle> candles);
+
+class CompressedIterator;
+
+class CompressedDataset {
+ public:
+  explicit CompressedDataset(const std::string& path);
+
+  CompressedDataset(const CompressedDataset&) = delete;
+  CompressedDataset& operator=(const CompressedDataset&) = delete;
+
+  CompressedIterator iterator(std::optional<std::string> start_time = {},
+                              std::optional<std::string> end_time = {}) const;
+  // Candles with open_time in [start_time, end_time].
+  CompressedIterator iterator(int64_t start_time, int64_t end_time) const;
+
+  // Appends the matching candles to `result`, returns how many were added.
+  size_t query(const CandleQuery& query, std::vector<Candle>& result) const;
+
+  size_t size() const { return size_; }
+  size_t block_count() const { return blocks_.size(); }
+  const BlockInfo& block(size_t index) const { return blocks_[index]; }
+  std::span<const Zone> zones() const { return zones_; }
+  size_t decode_block(size_t index, std::span<Candle> candles) const;
+
+ private:
+  boost::interprocess::file_mapping file_;
+  boost::interprocess::mapped_region region_;
+  const uint8_t* base_;
+  std::vector<BlockInfo> blocks_;
+  std::vector<Zone> zones_;
+  size_t size_;
+};
+
+class CompressedIterator {
+ public:
+  CompressedIterator(const CompressedDataset* dataset, int64_t start_time,
+                     int64_t end_time)
+      : dataset_(dataset),
+        start_time_(start_time),
+        end_time_(end_time),
+        buffer_(kCompressedBlockSize),
+        block_(seek_zone(dataset->zones(), start_time)) {}
+
+  std::optional<Candle> next();
+  size_t next_batch(std::span<Candle> candles);
+
+ private:
+  bool fill();
+
+  const CompressedDataset* dataset_;
+  int64_t start_time_;
+  int64_t end_time_;
+  std::vector<Candle> buffer_;
+  size_t block_;
+  size_t index_ = 0;
+  size_t end_ = 0;
+  bool done_ = false;
+};
+
+class CompressedWriter {
+ public:
+  explicit CompressedWriter(const std::string& path);
+
+  CompressedWriter(const CompressedWriter&) = delete;
+  CompressedWriter& operator=(const CompressedWriter&) = delete;
+
+  ~CompressedWriter();
+
+  void append(const Candle& candle);
+
+ private:
+  void flush();
+
+  std::ofstream file_;
+  std::vector<Candle> pending_;
+  std::vector<BlockInfo> blocks_;
+  std::string buffer_;
+  uint64_t offset_ = sizeof(CompressedHeader);
+  uint64_t count_ = 0;
+};
+
+}  // namespace wedge
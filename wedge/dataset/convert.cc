@@ -0,0 +1,84 @@
+#include <iostream>
+#include <span>
+#include <vector>
+
+#include "wedge/dataset/column_dataset.h"
+#include "wedge/dataset/compressed_dataset.h"
+#include "wedge/dataset/dataset_format.h"
+#include "wedge/dataset/sql_dataset.h"
+
+using namespace wedge;
+
+const size_t kBatchSize = 4096;
+
+template <class Iterator, class Sink>
+static void copy(Iterator &iterator, Sink &&sink) {
+  std::vector<Candle> buffer(kBatchSize);
+  while (size_t count = iterator.next_batch(buffer)) {
+    sink(std::span<const Candle>(buffer).first(count));
+  }
+}
+
+template <class Writer>
+static auto append_to(Writer &writer) {
+  return [&writer](std::span<const Candle> candles) {
+    for (const Candle &candle : candles) {
+      writer.append(candle);
+    }
+  };
+}
+
+template <class Iterator>
+static void write(Iterator &iterator, const std::string &path) {
+  switch (dataset_format(path)) {
+    case DatasetFormat::kSql: {
+      SqlDataset dataset(path);
+      copy(iterator, [&](std::span<const Candle> candles) {
+        dataset.insert_batch(candles, InsertMode::kUpsert);
+      });
+      break;
+    }
+    case DatasetFormat::kColumn: {
+      ColumnWriter writer(path);
+      copy(iterator, append_to(writer));
+      break;
+    }
+    case DatasetFormat::kCompressed: {
+      CompressedWriter writer(path);
+      copy(iterator, append_to(writer));
+      break;
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    std::cerr << "usage: wedge.convert <from dataset> <to dataset>"
+              << std::endl;
+    return 1;
+  }
+
+  auto from = PROJECT_ROOT_DIR "/dataset/" + std::string(argv[1]);
+  auto to = PROJECT_ROOT_DIR "/dataset/" + std::string(argv[2]);
+  switch (dataset_format(from)) {
+    case DatasetFormat::kSql: {
+      SqlDataset dataset(from);
+      auto iterator = dataset.iterator();
+      write(iterator, to);
+      break;
+    }
+    case DatasetFormat::kColumn: {
+      ColumnDataset dataset(from);
+      auto iterator = dataset.iterator();
+      write(iterator, to);
+      break;
+    }
+    case DatasetFormat::kCompressed: {
+      CompressedDataset dataset(from);
+      auto iterator = dataset.iterator();
+      write(iterator, to);
+      break;
+    }
+  }
+  return 0;
+}
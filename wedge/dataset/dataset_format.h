@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string_view>
+
+namespace wedge {
+
+enum class DatasetFormat {
+  kSql,
+  kColumn,
+  kCompressed,
+};
+
+// Column datasets are directories named *.wcol, compressed datasets are
+// *.wcmp files, anything else is a SQLite file.
+inline DatasetFormat dataset_format(std::string_view path) {
+  if (path.ends_with(".wcol")) {
+    return DatasetFormat::kColumn;
+  }
+  if (path.ends_with(".wcmp")) {
+    return DatasetFormat::kCompressed;
+  }
+  return DatasetFormat::kSql;
+}
+
+}  // namespace wedge
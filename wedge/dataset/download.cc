@@ -1,81 +1,561 @@
 #include <fmt/core.h>
 
+#include <atomic>
+#include <charconv>
+#include <deque>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
 
 #include "wedge/binance/binance_http_client.h"
 #include "wedge/binance/market/klines.h"
+#include "wedge/binance/rate_limiter.h"
+#include "wedge/common/bounded_queue.h"
 #include "wedge/common/chrono.h"
+#include "wedge/dataset/rollup_builder.h"
 #include "wedge/dataset/sql_dataset.h"
 
 using namespace wedge;
 
-asio::awaitable<void> download(ssl::context &ssl_context, SqlDataset &dataset,
-                               std::string_view symbol,
-                               market::KlineInterval interval) {
-  auto executor = co_await asio::this_coro::executor;
-  auto now = SystemClock::now();
+const int kKlinesWeight = 2;
+const uint32_t kKlinesLimit = 1000;
+const int kMaxAttempts = 3;
+const size_t kQueueCapacity = 16;
+
+struct Task {
+  std::string symbol;
+  std::string interval;
+  std::string filename;
+  // Keep 3m ... 1d series derived from this 1m dataset up to date.
+  bool rollup = false;
+  NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(Task, symbol, interval, filename,
+                                              rollup)
+};
+
+struct Config {
+  std::vector<Task> tasks;
+  int concurrency = 4;
+  int weight_per_minute = 6000;
+  // Shards are aligned to multiples of this many days since the epoch, keep
+  // it fixed between runs so partially downloaded shards can resume.
+  int shard_days = 30;
+  NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(Config, tasks, concurrency,
+                                              weight_per_minute, shard_days)
+};
+
+// Shared by a shard and its pages across the stages. Once a page fails to
+// decode or store, the shard stops fetching and the pages from there on are
+// dropped, so the stored candles stay a contiguous prefix of the shard and the
+// next run resumes at the failed page.
+struct ShardStatus {
+  std::string symbol;
+  std::atomic<bool> failed = false;
+  std::atomic<int64_t> resume_time = std::numeric_limits<int64_t>::max();
+
+  void fail(int64_t time) {
+    failed = true;
+    int64_t current = resume_time;
+    while (time < current &&
+           !resume_time.compare_exchange_weak(current, time)) {
+    }
+  }
+
+  bool dropped(int64_t time) const { return time >= resume_time; }
+};
+
+struct Shard {
+  SqlDataset *dataset;
+  std::string symbol;
+  market::KlineInterval interval;
+  int64_t start_time;
+  int64_t end_time;
+  std::shared_ptr<ShardStatus> status;
+  int attempts = 0;
+};
+
+// A raw klines page on its way from the fetch stage to the decode stage.
+struct Page {
+  SqlDataset *dataset;
+  std::shared_ptr<ShardStatus> status;
+  int64_t first_open_time;
+  json klines;
+};
+
+// Decoded candles on their way from the decode stage to the store stage.
+struct Batch {
+  SqlDataset *dataset;
+  std::shared_ptr<ShardStatus> status;
+  std::vector<Candle> candles;
+};
+
+// Bounds the pages in flight to the decode stage without blocking the io
+// thread. Fetchers wait on a timer that never expires, release() is posted
+// back to the io executor by the decode thread and wakes one of them.
+class PageCredits {
+  using Timer = asio::steady_timer;
 
-  BinanceHttpClient client(executor, ssl_context);
-  auto ec = co_await client.connect();
-  if (ec) {
+ public:
+  PageCredits(asio::any_io_executor executor, size_t count)
+      : executor_(executor),
+        credits_(count),
+        timer_(executor, Timer::time_point::max()) {}
+
+  asio::awaitable<void> acquire() {
+    while (credits_ == 0) {
+      // Canceled by release(), the timer itself never expires.
+      auto [ec] = co_await timer_.async_wait(asio::as_tuple);
+    }
+    credits_--;
+  }
+
+  // Safe to call from any thread.
+  void release() {
+    asio::post(executor_, [this] {
+      credits_++;
+      timer_.cancel_one();
+    });
+  }
+
+ private:
+  asio::any_io_executor executor_;
+  size_t credits_;
+  Timer timer_;
+};
+
+// Busy time is the wall time with at least one page in the stage. It
+// excludes waiting on the queues and the rate limiter, and concurrent fetches
+// count once, so the stage with the lowest candles per busy second is the one
+// that limits the pipeline. Each stage is driven from a single thread.
+class StageStats {
+  using Clock = std::chrono::steady_clock;
+
+ public:
+  explicit StageStats(const char *name) : name_(name) {}
+
+  void start() {
+    if (active_++ == 0) {
+      busy_since_ = Clock::now();
+    }
+  }
+
+  // Ends one start(), `candles` is zero when the page failed or was empty.
+  void stop(size_t candles) {
+    if (candles > 0) {
+      pages_ += 1;
+      candles_ += candles;
+    }
+    if (--active_ == 0) {
+      auto busy = duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                            busy_since_);
+      busy_us_ += busy.count();
+    }
+  }
+
+  void report() const {
+    double seconds = busy_us_ / 1e6;
+    std::cerr << fmt::format(
+                     "{}: {} pages, {} candles, busy {:.2f}s, {:.0f} candles/s",
+                     name_, pages_.load(), candles_.load(), seconds,
+                     seconds > 0 ? candles_ / seconds : 0)
+              << std::endl;
+  }
+
+ private:
+  const char *name_;
+  int active_ = 0;
+  Clock::time_point busy_since_;
+  std::atomic<uint64_t> pages_ = 0;
+  std::atomic<uint64_t> candles_ = 0;
+  std::atomic<int64_t> busy_us_ = 0;
+};
+
+static double parse_double(const json &value) {
+  const auto &str = value.get_ref<const std::string &>();
+  const char *end = str.data() + str.size();
+  double result = 0;
+  auto [ptr, ec] = std::from_chars(str.data(), end, result);
+  if (ec != std::errc() || ptr != end) {
+    throw std::runtime_error("invalid number \"" + str + "\"");
+  }
+  return result;
+}
+
+static int parse_header(const BinanceResponce &response,
+                        beast::string_view key) {
+  auto iter = response.find(key);
+  if (iter == response.end()) {
+    return 0;
+  }
+  auto value = iter->value();
+  int result = 0;
+  std::from_chars(value.data(), value.data() + value.size(), result);
+  return result;
+}
+
+// Shortest duration of one kline. A shard whose last stored candle reaches
+// its end this way is complete, months count as 28 days so a short guess only
+// refetches.
+static int64_t min_interval_ms(market::KlineInterval interval) {
+  constexpr int64_t kMinute = 60'000;
+  constexpr int64_t kHour = 60 * kMinute;
+  constexpr int64_t kDay = 24 * kHour;
+  // In KlineInterval order.
+  constexpr int64_t kLengths[] = {
+      kMinute,   3 * kMinute, 5 * kMinute, 15 * kMinute, 30 * kMinute,
+      kHour,     2 * kHour,   4 * kHour,   6 * kHour,    8 * kHour,
+      12 * kHour, kDay,       3 * kDay,    7 * kDay,     28 * kDay,
+  };
+  return kLengths[static_cast<int>(interval)];
+}
+
+static void report_exception(std::exception_ptr ptr) {
+  try {
+    if (ptr) std::rethrow_exception(ptr);
+  } catch (std::exception &e) {
+    std::cerr << e.what() << std::endl;
+  }
+}
+
+class Downloader {
+ public:
+  Downloader(asio::any_io_executor executor, ssl::context &ssl_context,
+             const Config &config)
+      : ssl_context_(ssl_context),
+        config_(config),
+        limiter_(config_.weight_per_minute),
+        credits_(executor, kQueueCapacity) {}
+
+  asio::awaitable<void> run();
+
+  // Decode and store stages, each runs on its own thread.
+  void decode();
+  void store();
+
+  // Called after the io_context is drained, no more pages will be fetched.
+  void finish() { pages_.close(); }
+
+  void report() const {
+    fetch_stats_.report();
+    decode_stats_.report();
+    store_stats_.report();
+  }
+
+  // Prints every shard that did not complete, returns whether there were any.
+  bool report_failures() const;
+
+ private:
+  asio::awaitable<bool> reconnect(BinanceHttpClient &client);
+  // Callers take the request weight from limiter_ first, so fetch timing
+  // leaves out the wait for it.
+  asio::awaitable<result<BinanceResponce>> send(BinanceHttpClient &client,
+                                                const Request &request);
+  // Empty when the symbol has no klines, an error when it could not be read.
+  asio::awaitable<result<std::optional<int64_t>>> first_open_time(
+      BinanceHttpClient &client, const Task &task);
+  asio::awaitable<void> worker();
+  asio::awaitable<bool> download(BinanceHttpClient &client, Shard &shard);
+
+  ssl::context &ssl_context_;
+  Config config_;
+  RateLimiter limiter_;
+  std::vector<std::unique_ptr<SqlDataset>> datasets_;
+  std::deque<Shard> shards_;
+  std::vector<std::shared_ptr<ShardStatus>> statuses_;
+  // Tasks whose shards were never planned.
+  std::vector<std::string> failed_tasks_;
+
+  // Pages are only pushed with a credit, so the push never waits.
+  PageCredits credits_;
+  BoundedQueue<Page> pages_{kQueueCapacity};
+  BoundedQueue<Batch> batches_{kQueueCapacity};
+  StageStats fetch_stats_{"fetch"};
+  StageStats decode_stats_{"decode"};
+  StageStats store_stats_{"store"};
+};
+
+// Connects with a doubling delay between attempts, false after kMaxAttempts
+// failures.
+asio::awaitable<bool> Downloader::reconnect(BinanceHttpClient &client) {
+  auto executor = co_await asio::this_coro::executor;
+  for (int attempt = 0; attempt < kMaxAttempts; attempt++) {
+    if (attempt > 0) {
+      asio::steady_timer timer(executor, std::chrono::seconds(1 << attempt));
+      co_await timer.async_wait(asio::use_awaitable);
+    }
+    auto ec = co_await client.connect();
+    if (!ec) {
+      co_return true;
+    }
     std::cerr << "Connect error: " << ec.message() << std::endl;
-    co_return;
   }
+  co_return false;
+}
 
-  int64_t start_time = dataset.get_max_start_time();
-  int64_t end_time =
-      duration_cast<Milliseconds>(now.time_since_epoch()).count();
+asio::awaitable<result<BinanceResponce>> Downloader::send(
+    BinanceHttpClient &client, const Request &request) {
+  auto response = co_await client.send(request);
+  if (response.has_error()) {
+    co_return response;
+  }
+  limiter_.update_used_weight(
+      parse_header(*response, "x-mbx-used-weight-1m"));
+  // 429 asks us to slow down, 418 means the IP has been banned for a while.
+  unsigned status = response->result_int();
+  if (status == 429 || status == 418) {
+    int retry_after = parse_header(*response, "retry-after");
+    limiter_.back_off(std::chrono::seconds(std::max(retry_after, 1)));
+    co_return make_error_code(
+        boost::system::errc::resource_unavailable_try_again);
+  }
+  if (!response->body().is_array()) {
+    co_return make_error_code(boost::system::errc::bad_message);
+  }
+  co_return response;
+}
 
-  while (start_time < end_time) {
-    auto response = co_await client.send(market::Klines(symbol, interval)
-                                             .start_time(start_time)
-                                             .end_time(end_time)
-                                             .limit(1000));
+asio::awaitable<result<std::optional<int64_t>>> Downloader::first_open_time(
+    BinanceHttpClient &client, const Task &task) {
+  auto request = market::Klines(task.symbol, market::from_str(task.interval))
+                     .start_time(int64_t{0})
+                     .limit(1);
+  error_code error;
+  for (int attempt = 0; attempt < kMaxAttempts; attempt++) {
+    co_await limiter_.acquire(kKlinesWeight);
+    auto response = co_await send(client, request);
+    if (!response.has_error()) {
+      if (response->body().empty()) co_return std::nullopt;
+      co_return response->body()[0][0].get<int64_t>();
+    }
+    error = response.error();
+    std::cerr << "Send error: " << error.message() << std::endl;
+    if (!co_await reconnect(client)) {
+      break;
+    }
+  }
+  co_return error;
+}
+
+asio::awaitable<bool> Downloader::download(BinanceHttpClient &client,
+                                           Shard &shard) {
+  int64_t start_time = shard.start_time;
+  while (start_time < shard.end_time) {
+    if (shard.status->failed) {
+      // Reported by report_failures, retrying would leave a gap.
+      co_return true;
+    }
+    co_await limiter_.acquire(kKlinesWeight);
+    fetch_stats_.start();
+    auto response =
+        co_await send(client, market::Klines(shard.symbol, shard.interval)
+                                  .start_time(start_time)
+                                  .end_time(shard.end_time - 1)
+                                  .limit(kKlinesLimit));
     if (response.has_error()) {
+      fetch_stats_.stop(0);
       std::cerr << "Send error: " << response.error().message() << std::endl;
-      static int count = 0;
-      if (++count >= 3) co_return;
-      co_await client.connect();
+      shard.start_time = start_time;
+      co_return false;
+    }
+    json &klines = response->body();
+    size_t count = klines.size();
+    fetch_stats_.stop(count);
+    if (klines.empty()) {
+      break;
+    }
+
+    // Only the last close time is needed to send the next request, the rest
+    // of the page is decoded while that request is in flight. Only this
+    // fetcher waits while decode is behind.
+    int64_t first_open_time = klines.front()[0].get<int64_t>();
+    start_time = klines.back()[6].get<int64_t>();
+    co_await credits_.acquire();
+    pages_.push(Page{
+        .dataset = shard.dataset,
+        .status = shard.status,
+        .first_open_time = first_open_time,
+        .klines = std::move(klines),
+    });
+    if (count < kKlinesLimit) {
+      break;
+    }
+  }
+  co_return true;
+}
+
+void Downloader::decode() {
+  while (auto page = pages_.pop()) {
+    credits_.release();
+    if (page->status->dropped(page->first_open_time)) {
       continue;
     }
+    decode_stats_.start();
+    Batch batch{.dataset = page->dataset, .status = page->status};
+    batch.candles.reserve(page->klines.size());
+    try {
+      for (auto &kline : page->klines) {
+        Candle candle;
+        candle.open_time = kline[0].get<int64_t>();
+        candle.close_time = kline[6].get<int64_t>();
+        candle.open_price = parse_double(kline[1]);
+        candle.high_price = parse_double(kline[2]);
+        candle.low_price = parse_double(kline[3]);
+        candle.close_price = parse_double(kline[4]);
+        candle.volume = parse_double(kline[5]);
+        candle.quote_volume = parse_double(kline[7]);
+        candle.traders = kline[8].get<int>();
+        candle.taker_buy_base = parse_double(kline[9]);
+        candle.taker_buy_quote = parse_double(kline[10]);
+        batch.candles.push_back(candle);
+      }
+    } catch (std::exception &e) {
+      decode_stats_.stop(0);
+      std::cerr << "Decode error: " << e.what() << std::endl;
+      page->status->fail(page->first_open_time);
+      continue;
+    }
+    decode_stats_.stop(batch.candles.size());
+    batches_.push(std::move(batch));
+  }
+  batches_.close();
+}
 
-    auto get_double = [](const json &value) -> double {
-      return std::stod(value.get<std::string>());
-    };
+void Downloader::store() {
+  while (auto batch = batches_.pop()) {
+    if (batch->candles.empty() ||
+        batch->status->dropped(batch->candles.front().open_time)) {
+      continue;
+    }
+    store_stats_.start();
+    try {
+      batch->dataset->insert_batch(batch->candles, InsertMode::kUpsert);
+    } catch (std::exception &e) {
+      store_stats_.stop(0);
+      std::cerr << "Store error: " << e.what() << std::endl;
+      batch->status->fail(batch->candles.front().open_time);
+      continue;
+    }
+    store_stats_.stop(batch->candles.size());
+  }
+}
 
-    for (auto &kline : response->body()) {
-      Candle candle;
-      candle.open_time = kline[0].get<int64_t>();
-      candle.close_time = kline[6].get<int64_t>();
-      candle.open_price = get_double(kline[1]);
-      candle.high_price = get_double(kline[2]);
-      candle.low_price = get_double(kline[3]);
-      candle.close_price = get_double(kline[4]);
-      candle.volume = get_double(kline[5]);
-      candle.quote_volume = get_double(kline[7]);
-      candle.traders = kline[8].get<int>();
-      candle.taker_buy_base = get_double(kline[9]);
-      candle.taker_buy_quote = get_double(kline[10]);
-      dataset.insert(candle);
-      start_time = candle.close_time;
+bool Downloader::report_failures() const {
+  // Shards still queued were left when every worker lost its connection.
+  for (const Shard &shard : shards_) {
+    shard.status->fail(shard.start_time);
+  }
+  bool failed = !failed_tasks_.empty();
+  for (const auto &symbol : failed_tasks_) {
+    std::cerr << fmt::format("Failed {}, nothing was downloaded", symbol)
+              << std::endl;
+  }
+  for (const auto &status : statuses_) {
+    if (status->failed) {
+      std::cerr << fmt::format("Failed {} from {}", status->symbol,
+                               status->resume_time.load())
+                << std::endl;
+      failed = true;
     }
   }
+  return failed;
 }
 
-struct Task {
-  std::string symbol;
-  std::string interval;
-  std::string filename;
-  NLOHMANN_DEFINE_TYPE_INTRUSIVE(Task, symbol, interval, filename)
-};
+asio::awaitable<void> Downloader::worker() {
+  auto executor = co_await asio::this_coro::executor;
+  BinanceHttpClient client(executor, ssl_context_);
+  if (!co_await reconnect(client)) {
+    co_return;
+  }
 
-struct Config {
-  std::vector<Task> tasks;
-  NLOHMANN_DEFINE_TYPE_INTRUSIVE(Config, tasks)
-};
+  while (!shards_.empty()) {
+    Shard shard = std::move(shards_.front());
+    shards_.pop_front();
+    if (co_await download(client, shard)) {
+      continue;
+    }
+    if (++shard.attempts < kMaxAttempts) {
+      shards_.push_back(std::move(shard));
+    } else {
+      std::cerr << fmt::format("Give up {} from {}", shard.symbol,
+                               shard.start_time)
+                << std::endl;
+      shard.status->fail(shard.start_time);
+    }
+    if (!co_await reconnect(client)) {
+      co_return;
+    }
+  }
+}
 
-asio::awaitable<void> async_main() {
+asio::awaitable<void> Downloader::run() {
+  auto executor = co_await asio::this_coro::executor;
+  auto now = SystemClock::now();
+  int64_t end_time =
+      duration_cast<Milliseconds>(now.time_since_epoch()).count();
+  int64_t shard_size = duration_cast<Milliseconds>(
+                           Hours(24) * std::max(config_.shard_days, 1))
+                           .count();
+
+  BinanceHttpClient client(executor, ssl_context_);
+  if (!co_await reconnect(client)) {
+    for (const auto &task : config_.tasks) {
+      failed_tasks_.push_back(task.symbol);
+    }
+    co_return;
+  }
+
+  for (const auto &task : config_.tasks) {
+    auto path = fmt::format(PROJECT_ROOT_DIR "/dataset/{}", task.filename);
+    auto &dataset = datasets_.emplace_back(std::make_unique<SqlDataset>(path));
+
+    auto first_result = co_await first_open_time(client, task);
+    if (first_result.has_error()) {
+      failed_tasks_.push_back(task.symbol);
+      continue;
+    }
+    auto first_time = *first_result;
+    if (!first_time) {
+      std::cerr << "No klines for " << task.symbol << std::endl;
+      continue;
+    }
+
+    auto interval = market::from_str(task.interval);
+    int64_t shard_begin = *first_time / shard_size * shard_size;
+    for (; shard_begin < end_time; shard_begin += shard_size) {
+      int64_t shard_end = std::min(shard_begin + shard_size, end_time);
+      int64_t start_time = std::max(shard_begin, *first_time);
+      if (auto last = dataset->get_max_open_time(shard_begin, shard_end)) {
+        // Complete shards are skipped, except the one still being formed.
+        if (shard_end < end_time &&
+            *last + min_interval_ms(interval) >= shard_end) {
+          continue;
+        }
+        // Refetch the last stored candle, it may have been incomplete.
+        start_time = *last;
+      }
+      auto &status = statuses_.emplace_back(std::make_shared<ShardStatus>());
+      status->symbol = task.symbol;
+      shards_.push_back(Shard{
+          .dataset = dataset.get(),
+          .symbol = task.symbol,
+          .interval = interval,
+          .start_time = start_time,
+          .end_time = shard_end,
+          .status = status,
+      });
+    }
+  }
+  co_await client.shutdown();
+
+  for (int i = 0; i < std::max(config_.concurrency, 1); i++) {
+    asio::co_spawn(executor, worker(), report_exception);
+  }
+}
+
+int main() {
   std::string config_path = PROJECT_ROOT_DIR "/.wedge/dataset.json";
   std::ifstream config_file(config_path);
   ssl::context ssl_context(ssl::context::tlsv12_client);
@@ -83,27 +563,32 @@ asio::awaitable<void> async_main() {
 
   json json_data;
   config_file >> json_data;
+
+  asio::io_context io_context;
   auto config = json_data.get<Config>();
+  Downloader downloader(io_context.get_executor(), ssl_context, config);
+  std::thread decode_thread([&] { downloader.decode(); });
+  std::thread store_thread([&] { downloader.store(); });
 
-  for (const auto &task : config.tasks) {
-    auto path = fmt::format(PROJECT_ROOT_DIR "/dataset/{}", task.filename);
-    SqlDataset dataset(path);
-    co_await download(ssl_context, dataset, task.symbol,
-                      market::from_str(task.interval));
-  }
+  asio::co_spawn(io_context, downloader.run(), report_exception);
+  io_context.run();
 
-  co_return;
-}
+  downloader.finish();
+  decode_thread.join();
+  store_thread.join();
+  downloader.report();
+  bool failed = downloader.report_failures();
 
-int main() {
-  asio::io_context io_context;
-  asio::co_spawn(io_context, async_main(), [](std::exception_ptr ptr) {
-    try {
-      if (ptr) std::rethrow_exception(ptr);
-    } catch (std::exception &e) {
-      std::cerr << e.what() << std::endl;
+  for (const auto &task : config.tasks) {
+    if (task.rollup && task.interval == "1m") {
+      auto path = fmt::format(PROJECT_ROOT_DIR "/dataset/{}", task.filename);
+      try {
+        update_rollups(path);
+      } catch (std::exception &e) {
+        std::cerr << "Rollup error: " << e.what() << std::endl;
+        failed = true;
+      }
     }
-  });
-  io_context.run();
-  return 0;
-}
\ No newline at end of file
+  }
+  return failed ? 1 : 0;
+}
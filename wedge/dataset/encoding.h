@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace wedge {
+
+inline uint64_t zigzag_encode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t zigzag_decode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+inline void put_varint(std::string& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+inline uint64_t get_varint(const uint8_t*& in) {
+  uint64_t result = 0;
+  int shift = 0;
+  while (*in & 0x80) {
+    result |= static_cast<uint64_t>(*in++ & 0x7f) << shift;
+    shift += 7;
+  }
+  result |= static_cast<uint64_t>(*in++) << shift;
+  return result;
+}
+
+template <class T>
+void put_raw(std::string& out, T value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <class T>
+T get_raw(const uint8_t*& in) {
+  T value;
+  std::memcpy(&value, in, sizeof(T));
+  in += sizeof(T);
+  return value;
+}
+
+}  // namespace wedge
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "wedge/dataset/column_dataset.h"
+#include "wedge/dataset/compressed_dataset.h"
+#include "wedge/dataset/dataset_format.h"
+#include "wedge/dataset/kline_csv.h"
+#include "wedge/dataset/load_candles.h"
+#include "wedge/dataset/sql_dataset.h"
+#include "wedge/dataset/zip_reader.h"
+
+using namespace wedge;
+
+static std::vector<Candle> load_file(const std::string &path) {
+  std::vector<Candle> candles;
+  size_t rejected = 0;
+  if (path.ends_with(".zip")) {
+    for (const auto &content : read_zip(path)) {
+      rejected += parse_klines_csv(content, candles);
+    }
+  } else {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      throw std::runtime_error("cannot open " + path);
+    }
+    std::string content(std::istreambuf_iterator<char>(file), {});
+    rejected += parse_klines_csv(content, candles);
+  }
+  if (rejected > 0) {
+    throw std::runtime_error(std::to_string(rejected) + " malformed rows");
+  }
+  return candles;
+}
+
+// Parses every file on its own thread, files are claimed one at a time.
+// Files that fail to load are reported and counted in `failed`.
+static std::vector<Candle> load_files(const std::vector<std::string> &paths,
+                                      size_t &failed) {
+  std::vector<std::vector<Candle>> results(paths.size());
+  std::atomic<size_t> next = 0;
+  std::atomic<size_t> errors = 0;
+  auto worker = [&] {
+    for (size_t i = next++; i < paths.size(); i = next++) {
+      try {
+        results[i] = load_file(paths[i]);
+      } catch (std::exception &e) {
+        std::cerr << paths[i] << ": " << e.what() << std::endl;
+        errors++;
+      }
+    }
+  };
+
+  size_t thread_count = std::min<size_t>(
+      paths.size(), std::max(1u, std::thread::hardware_concurrency()));
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < thread_count; i++) {
+    threads.emplace_back(worker);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  failed = errors;
+  std::vector<Candle> candles;
+  for (auto &result : results) {
+    candles.insert(candles.end(), result.begin(), result.end());
+  }
+  return candles;
+}
+
+// Sorts by open_time and keeps the last of equal open times, so later
+// candles win.
+static void sort_unique(std::vector<Candle> &candles) {
+  std::stable_sort(candles.begin(), candles.end(),
+                   [](const Candle &lhs, const Candle &rhs) {
+                     return lhs.open_time < rhs.open_time;
+                   });
+  auto last = std::unique(candles.rbegin(), candles.rend(),
+                          [](const Candle &lhs, const Candle &rhs) {
+                            return lhs.open_time == rhs.open_time;
+                          });
+  candles.erase(candles.begin(), last.base());
+}
+
+template <class Writer>
+static void write_all(const std::string &path,
+                      const std::vector<Candle> &candles) {
+  Writer writer(path);
+  for (const Candle &candle : candles) {
+    writer.append(candle);
+  }
+}
+
+// Column and compressed stores can only be written whole, so the imported
+// candles are merged over the existing ones and the store is rewritten next
+// to the old one before replacing it.
+template <class Writer>
+static void merge_into(const std::string &path, std::vector<Candle> candles) {
+  if (std::filesystem::exists(path)) {
+    auto existing = load_candles(path, 0, std::numeric_limits<int64_t>::max());
+    candles.insert(candles.begin(), existing.begin(), existing.end());
+    sort_unique(candles);
+  }
+  auto temp_path = path + ".tmp";
+  std::filesystem::remove_all(temp_path);
+  write_all<Writer>(temp_path, candles);
+  std::filesystem::remove_all(path);
+  std::filesystem::rename(temp_path, path);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    std::cerr << "usage: wedge.import <dataset> <csv or zip>..." << std::endl;
+    return 1;
+  }
+
+  std::vector<std::string> paths(argv + 2, argv + argc);
+  size_t failed = 0;
+  auto candles = load_files(paths, failed);
+  // Later files win when archives overlap.
+  sort_unique(candles);
+
+  auto dataset_path = PROJECT_ROOT_DIR "/dataset/" + std::string(argv[1]);
+  switch (dataset_format(dataset_path)) {
+    case DatasetFormat::kSql: {
+      SqlDataset dataset(dataset_path);
+      dataset.insert_batch(candles, InsertMode::kUpsert);
+      break;
+    }
+    case DatasetFormat::kColumn:
+      merge_into<ColumnWriter>(dataset_path, candles);
+      break;
+    case DatasetFormat::kCompressed:
+      merge_into<CompressedWriter>(dataset_path, candles);
+      break;
+  }
+  std::cerr << "imported " << candles.size() << " candles" << std::endl;
+  if (failed > 0) {
+    std::cerr << failed << " of " << paths.size() << " files failed"
+              << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include "wedge/dataset/kline_csv.h"
+
+#include <cctype>
+#include <charconv>
+
+namespace wedge {
+
+// Timestamps above this are in microseconds, Binance switched the spot
+// archives to microseconds in 2025.
+const int64_t kMicrosecondThreshold = 100'000'000'000'000;
+
+class FieldReader {
+ public:
+  FieldReader(const char* first, const char* last)
+      : first_(first), last_(last) {}
+
+  template <class T>
+  bool read(T& value) {
+    auto [ptr, ec] = std::from_chars(first_, last_, value);
+    if (ec != std::errc()) {
+      return false;
+    }
+    // A field ends at a comma or the end of the line, "123abc" is no number.
+    if (ptr == last_ || *ptr == '\r') {
+      first_ = last_;
+    } else if (*ptr == ',') {
+      first_ = ptr + 1;
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  const char* first_;
+  const char* last_;
+};
+
+static bool parse_line(std::string_view line, Candle& candle) {
+  FieldReader reader(line.data(), line.data() + line.size());
+  bool ok = reader.read(candle.open_time) && reader.read(candle.open_price) &&
+            reader.read(candle.high_price) && reader.read(candle.low_price) &&
+            reader.read(candle.close_price) && reader.read(candle.volume) &&
+            reader.read(candle.close_time) &&
+            reader.read(candle.quote_volume) && reader.read(candle.traders) &&
+            reader.read(candle.taker_buy_base) &&
+            reader.read(candle.taker_buy_quote);
+  if (!ok) {
+    return false;
+  }
+  if (candle.open_time > kMicrosecondThreshold) {
+    candle.open_time /= 1000;
+    candle.close_time /= 1000;
+  }
+  return true;
+}
+
+size_t parse_klines_csv(std::string_view text, std::vector<Candle>& candles) {
+  size_t rejected = 0;
+  bool first = true;
+  while (!text.empty()) {
+    size_t end = text.find('\n');
+    std::string_view line = text.substr(0, end);
+    text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+    if (line.ends_with('\r')) {
+      line.remove_suffix(1);
+    }
+
+    bool header = first && !line.empty() &&
+                  !std::isdigit(static_cast<unsigned char>(line.front()));
+    first = false;
+    if (header || line.empty()) {
+      continue;
+    }
+    Candle candle;
+    if (parse_line(line, candle)) {
+      candles.push_back(candle);
+    } else {
+      rejected++;
+    }
+  }
+  return rejected;
+}
+
+}  // namespace wedge
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "wedge/common/candle.h"
+
+namespace wedge {
+
+// Parses a Binance bulk klines CSV (data.binance.vision). A header line is
+// skipped, microsecond timestamps are scaled down to milliseconds. Returns
+// the number of malformed rows, which are left out of `candles`.
+size_t parse_klines_csv(std::string_view text, std::vector<Candle>& candles);
+
+}  // namespace wedge
@@ -0,0 +1,49 @@
+#include "wedge/dataset/load_candles.h"
+
+#include <span>
+
+#include "wedge/dataset/column_dataset.h"
+#include "wedge/dataset/compressed_dataset.h"
+#include "wedge/dataset/dataset_format.h"
+#include "wedge/dataset/sql_dataset.h"
+
+namespace wedge {
+
+template <class Iterator>
+static void read_all(Iterator iterator, std::vector<Candle>& candles) {
+  constexpr size_t kReadBatch = 4096;
+  for (;;) {
+    size_t size = candles.size();
+    candles.resize(size + kReadBatch);
+    size_t count = iterator.next_batch(std::span(candles).subspan(size));
+    candles.resize(size + count);
+    if (count == 0) {
+      break;
+    }
+  }
+}
+
+std::vector<Candle> load_candles(const std::string& path, int64_t start_time,
+                                 int64_t end_time) {
+  std::vector<Candle> candles;
+  switch (dataset_format(path)) {
+    case DatasetFormat::kSql: {
+      SqlDataset dataset(path);
+      read_all(dataset.iterator(start_time, end_time), candles);
+      break;
+    }
+    case DatasetFormat::kColumn: {
+      ColumnDataset dataset(path);
+      read_all(dataset.iterator(start_time, end_time), candles);
+      break;
+    }
+    case DatasetFormat::kCompressed: {
+      CompressedDataset dataset(path);
+      read_all(dataset.iterator(start_time, end_time), candles);
+      break;
+    }
+  }
+  return candles;
+}
+
+}  // namespace wedge
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "wedge/common/candle.h"
+
+namespace wedge {
+
+// Candles of any dataset format with open_time in [start_time, end_time].
+std::vector<Candle> load_candles(const std::string& path, int64_t start_time,
+                                 int64_t end_time);
+
+}  // namespace wedge
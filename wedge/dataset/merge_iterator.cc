@@ -0,0 +1,52 @@
+#include "wedge/dataset/merge_iterator.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace wedge {
+
+const Candle* MergeIterator::head(Source& source) {
+  if (source.index == source.count && !source.done) {
+    source.count = source.next_batch(source.buffer);
+    source.index = 0;
+    source.done = source.count == 0;
+  }
+  return source.done ? nullptr : &source.buffer[source.index];
+}
+
+bool MergeIterator::next() {
+  // Consume the candles handed out by the previous step first, the slots
+  // point into the source buffers which a refill would overwrite.
+  for (size_t i = 0; i < sources_.size(); i++) {
+    if (candles_[i]) {
+      sources_[i].index++;
+      candles_[i] = nullptr;
+    }
+  }
+
+  int64_t open_time = std::numeric_limits<int64_t>::max();
+  bool found = false;
+  for (Source& source : sources_) {
+    if (const Candle* candle = head(source)) {
+      open_time = std::min(open_time, candle->open_time);
+      found = true;
+    }
+  }
+  if (!found) {
+    return false;
+  }
+
+  open_time_ = open_time;
+  gaps_ = 0;
+  for (size_t i = 0; i < sources_.size(); i++) {
+    const Candle* candle = head(sources_[i]);
+    if (candle && candle->open_time == open_time) {
+      candles_[i] = candle;
+    } else {
+      gaps_++;
+    }
+  }
+  return true;
+}
+
+}  // namespace wedge
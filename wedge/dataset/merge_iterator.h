@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "wedge/common/candle.h"
+
+namespace wedge {
+
+// Streams several datasets aligned on open_time. Each step yields one
+// timestamp with a candle slot per source, a null slot means that source has
+// no candle at the timestamp. Only a small buffer per source is kept.
+class MergeIterator {
+  static constexpr size_t kBufferSize = 256;
+
+ public:
+  // The iterator must outlive the merge, any type with next_batch works.
+  template <class Iterator>
+  void add(Iterator& iterator) {
+    sources_.push_back(Source{
+        .next_batch = [&iterator](std::span<Candle> candles) {
+          return iterator.next_batch(candles);
+        },
+        .buffer = std::vector<Candle>(kBufferSize),
+    });
+    candles_.push_back(nullptr);
+  }
+
+  // Advances to the next timestamp, false once every source is exhausted.
+  bool next();
+
+  int64_t open_time() const { return open_time_; }
+
+  // One slot per source in the order they were added.
+  std::span<const Candle* const> candles() const { return candles_; }
+
+  // Number of sources without a candle at open_time.
+  size_t gaps() const { return gaps_; }
+
+ private:
+  struct Source {
+    std::function<size_t(std::span<Candle>)> next_batch;
+    std::vector<Candle> buffer;
+    size_t index = 0;
+    size_t count = 0;
+    bool done = false;
+  };
+
+  static const Candle* head(Source& source);
+
+  std::vector<Source> sources_;
+  std::vector<const Candle*> candles_;
+  int64_t open_time_ = 0;
+  size_t gaps_ = 0;
+};
+
+}  // namespace wedge
@@ -0,0 +1,21 @@
+#include <exception>
+#include <iostream>
+
+#include "wedge/dataset/rollup_builder.h"
+
+using namespace wedge;
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    std::cerr << "usage: wedge.rollup <1m dataset>" << std::endl;
+    return 1;
+  }
+
+  try {
+    update_rollups(PROJECT_ROOT_DIR "/dataset/" + std::string(argv[1]));
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
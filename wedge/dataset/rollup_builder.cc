@@ -0,0 +1,169 @@
+#include "wedge/dataset/rollup_builder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "wedge/common/bounded_queue.h"
+#include "wedge/dataset/sql_dataset.h"
+
+namespace wedge {
+
+using SharedBatch = std::shared_ptr<const std::vector<Candle>>;
+
+const size_t kBatchSize = 16384;
+const size_t kQueueCapacity = 4;
+
+Candle merge(const Candle& previous, const Candle& current) {
+  if (previous.volume == 0) {
+    return current;
+  }
+  if (current.volume == 0) {
+    return previous;
+  }
+
+  assert(previous.close_time < current.open_time);
+
+  Candle result;
+  result.open_time = previous.open_time;
+  result.close_time = current.close_time;
+  result.open_price = previous.open_price;
+  result.close_price = current.close_price;
+  result.high_price = std::max(previous.high_price, current.high_price);
+  result.low_price = std::min(previous.low_price, current.low_price);
+  result.volume = previous.volume + current.volume;
+  result.quote_volume = previous.quote_volume + current.quote_volume;
+  result.traders = previous.traders + current.traders;
+  result.taker_buy_base = previous.taker_buy_base + current.taker_buy_base;
+  result.taker_buy_quote = previous.taker_buy_quote + current.taker_buy_quote;
+  return result;
+}
+
+std::optional<Candle> Rollup::update(const Candle& candle) {
+  int64_t bucket = candle.open_time / interval_ * interval_;
+  std::optional<Candle> result;
+  if (current_ && current_->open_time != bucket) {
+    result = flush();
+  }
+  current_ = current_ ? merge(*current_, candle) : candle;
+  current_->open_time = bucket;
+  return result;
+}
+
+std::optional<Candle> Rollup::flush() {
+  if (current_) {
+    current_->close_time = current_->open_time + interval_ - 1;
+  }
+  return std::exchange(current_, std::nullopt);
+}
+
+std::string rollup_path(std::string_view base_path,
+                        std::string_view interval) {
+  size_t slash = base_path.find_last_of("/\\");
+  size_t dot = base_path.find_last_of('.');
+  if (dot == std::string_view::npos ||
+      (slash != std::string_view::npos && dot < slash)) {
+    dot = base_path.size();
+  }
+  std::string result(base_path.substr(0, dot));
+  result.push_back('.');
+  result.append(interval);
+  result.append(base_path.substr(dot));
+  return result;
+}
+
+// On failure the error goes to `error` and the queue is closed, so the
+// reader's pushes to it stop waiting.
+static void roll(SqlDataset* dataset, int64_t interval, int64_t resume_time,
+                 BoundedQueue<SharedBatch>* queue, std::exception_ptr* error) {
+  try {
+    Rollup rollup(interval);
+    std::vector<Candle> candles;
+    while (auto batch = queue->pop()) {
+      for (const Candle& candle : **batch) {
+        if (candle.open_time < resume_time) continue;
+        if (auto done = rollup.update(candle)) {
+          candles.push_back(*done);
+        }
+      }
+      dataset->insert_batch(candles, InsertMode::kUpsert);
+      candles.clear();
+    }
+    if (auto last = rollup.flush()) {
+      dataset->insert_batch({&*last, 1}, InsertMode::kUpsert);
+    }
+  } catch (...) {
+    *error = std::current_exception();
+    queue->close();
+  }
+}
+
+void update_rollups(const std::string& base_path) {
+  constexpr size_t kCount = std::size(kRollupIntervals);
+  constexpr int64_t kMaxTime = std::numeric_limits<int64_t>::max();
+
+  std::vector<std::unique_ptr<SqlDataset>> datasets;
+  std::vector<std::unique_ptr<BoundedQueue<SharedBatch>>> queues;
+  std::vector<int64_t> resume_times;
+  for (const auto& interval : kRollupIntervals) {
+    auto& dataset = datasets.emplace_back(std::make_unique<SqlDataset>(
+        rollup_path(base_path, interval.name)));
+    queues.push_back(
+        std::make_unique<BoundedQueue<SharedBatch>>(kQueueCapacity));
+    // The last stored bucket may have been incomplete, rebuild it.
+    auto last_time = dataset->get_max_open_time(0, kMaxTime);
+    resume_times.push_back(last_time.value_or(0));
+  }
+
+  std::vector<std::exception_ptr> errors(kCount);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < kCount; i++) {
+    threads.emplace_back(roll, datasets[i].get(),
+                         kRollupIntervals[i].milliseconds, resume_times[i],
+                         queues[i].get(), &errors[i]);
+  }
+
+  // Read the base once, every interval consumes the same batches. A failed
+  // interval has closed its queue and no longer takes them.
+  std::exception_ptr read_error;
+  try {
+    SqlDataset base(base_path);
+    int64_t start_time =
+        *std::min_element(resume_times.begin(), resume_times.end());
+    auto iterator = base.iterator(start_time, kMaxTime);
+    for (;;) {
+      auto batch = std::make_shared<std::vector<Candle>>(kBatchSize);
+      batch->resize(iterator.next_batch(*batch));
+      if (batch->empty()) {
+        break;
+      }
+      for (auto& queue : queues) {
+        queue->push(batch);
+      }
+    }
+  } catch (...) {
+    read_error = std::current_exception();
+  }
+
+  for (auto& queue : queues) {
+    queue->close();
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (read_error) {
+    std::rethrow_exception(read_error);
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+}  // namespace wedge
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "wedge/common/candle.h"
+
+namespace wedge {
+
+struct RollupInterval {
+  const char* name;
+  int64_t milliseconds;
+};
+
+inline constexpr RollupInterval kRollupIntervals[] = {
+    {"3m", 3 * 60'000},         {"5m", 5 * 60'000},
+    {"15m", 15 * 60'000},       {"1h", 60 * 60'000},
+    {"4h", 4 * 60 * 60'000},    {"1d", 24 * 60 * 60'000},
+};
+
+Candle merge(const Candle& previous, const Candle& current);
+
+// Aggregates finer candles into buckets aligned to the interval since the
+// epoch, which matches how Binance aligns its own klines.
+class Rollup {
+ public:
+  explicit Rollup(int64_t interval) : interval_(interval) {}
+
+  // Returns the previous bucket once a candle of a later bucket arrives.
+  std::optional<Candle> update(const Candle& candle);
+
+  // Returns the last, possibly incomplete, bucket.
+  std::optional<Candle> flush();
+
+ private:
+  int64_t interval_;
+  std::optional<Candle> current_;
+};
+
+// "btcusdt_1m.db" -> "btcusdt_1m.4h.db"
+std::string rollup_path(std::string_view base_path, std::string_view interval);
+
+// Derives every kRollupIntervals series from a 1m SQLite dataset. Existing
+// rollups are extended from their last, possibly incomplete, bucket. Throws
+// the first read or write error once every interval has stopped.
+void update_rollups(const std::string& base_path);
+
+}  // namespace wedge
@@ -3,6 +3,9 @@
 #include <fmt/core.h>
 #include <sqlite3.h>
 
+#include <stdexcept>
+#include <string>
+
 namespace wedge {
 
 static bool is_new_dataset(sqlite3* db) {
@@ -43,18 +46,36 @@ SqlDataset::SqlDataset(const std::string& name) {
   }
 }
 
-SqlDataset::~SqlDataset() { sqlite3_close(db_); }
+SqlDataset::~SqlDataset() {
+  sqlite3_finalize(insert_stmt_);
+  sqlite3_finalize(upsert_stmt_);
+  sqlite3_close(db_);
+}
+
+sqlite3_stmt* SqlDataset::statement(InsertMode mode) {
+  sqlite3_stmt*& stmt =
+      mode == InsertMode::kInsert ? insert_stmt_ : upsert_stmt_;
+  if (stmt) {
+    return stmt;
+  }
 
-void SqlDataset::insert(const Candle& candle) {
   const char* insert_sql = R"(
       INSERT INTO klines (open_time, close_time, open_price, high_price, low_price, close_price, 
                           volume, quote_volume, traders, taker_buy_base, taker_buy_quote)
       VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);
     )";
+  const char* upsert_sql = R"(
+      INSERT OR REPLACE INTO klines (open_time, close_time, open_price, high_price, low_price, close_price, 
+                                     volume, quote_volume, traders, taker_buy_base, taker_buy_quote)
+      VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);
+    )";
+  const char* sql = mode == InsertMode::kInsert ? insert_sql : upsert_sql;
+  sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
+  return stmt;
+}
 
-  sqlite3_stmt* stmt;
-  sqlite3_prepare_v2(db_, insert_sql, -1, &stmt, nullptr);
-
+// Returns the result of sqlite3_step, SQLITE_DONE on success.
+static int bind_and_step(sqlite3_stmt* stmt, const Candle& candle) {
   sqlite3_bind_int64(stmt, 1, candle.open_time);
   sqlite3_bind_int64(stmt, 2, candle.close_time);
   sqlite3_bind_double(stmt, 3, candle.open_price);
@@ -67,8 +88,41 @@ void SqlDataset::insert(const Candle& candle) {
   sqlite3_bind_double(stmt, 10, candle.taker_buy_base);
   sqlite3_bind_double(stmt, 11, candle.taker_buy_quote);
 
-  sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
+  int rc = sqlite3_step(stmt);
+  sqlite3_reset(stmt);
+  return rc;
+}
+
+void SqlDataset::insert(const Candle& candle) {
+  bind_and_step(statement(InsertMode::kInsert), candle);
+}
+
+void SqlDataset::insert_batch(std::span<const Candle> candles,
+                              InsertMode mode) {
+  sqlite3_stmt* stmt = statement(mode);
+  if (!stmt) {
+    throw std::runtime_error(
+        fmt::format("prepare insert: {}", sqlite3_errmsg(db_)));
+  }
+  if (sqlite3_exec(db_, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr) !=
+      SQLITE_OK) {
+    throw std::runtime_error(
+        fmt::format("begin transaction: {}", sqlite3_errmsg(db_)));
+  }
+  // Nothing of the batch is kept unless all of it is.
+  auto fail = [this](std::string what) {
+    what += sqlite3_errmsg(db_);
+    sqlite3_exec(db_, "ROLLBACK;", nullptr, nullptr, nullptr);
+    throw std::runtime_error(what);
+  };
+  for (const Candle& candle : candles) {
+    if (bind_and_step(stmt, candle) != SQLITE_DONE) {
+      fail(fmt::format("insert candle {}: ", candle.open_time));
+    }
+  }
+  if (sqlite3_exec(db_, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    fail("commit: ");
+  }
 }
 
 SqlIterator SqlDataset::iterator(std::optional<std::string> start_time,
@@ -76,6 +130,10 @@ SqlIterator SqlDataset::iterator(std::optional<std::string> start_time,
   return SqlIterator(db_, start_time, end_time);
 }
 
+SqlIterator SqlDataset::iterator(int64_t start_time, int64_t end_time) {
+  return SqlIterator(db_, start_time, end_time);
+}
+
 int64_t SqlDataset::get_max_start_time() {
   const char* select_max_time_sql = "SELECT MAX(close_time) FROM klines;";
   sqlite3_stmt* stmt;
@@ -91,4 +149,24 @@ int64_t SqlDataset::get_max_start_time() {
   return max_start_time;
 }
 
+std::optional<int64_t> SqlDataset::get_max_open_time(int64_t begin,
+                                                     int64_t end) {
+  const char* select_max_time_sql =
+      "SELECT MAX(open_time) FROM klines WHERE open_time >= ? AND open_time "
+      "< ?;";
+  sqlite3_stmt* stmt;
+  sqlite3_prepare_v2(db_, select_max_time_sql, -1, &stmt, nullptr);
+  sqlite3_bind_int64(stmt, 1, begin);
+  sqlite3_bind_int64(stmt, 2, end);
+
+  std::optional<int64_t> max_open_time;
+  int rc = sqlite3_step(stmt);
+  if (rc == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+    max_open_time = sqlite3_column_int64(stmt, 0);
+  }
+  sqlite3_finalize(stmt);
+
+  return max_open_time;
+}
+
 }  // namespace wedge
\ No newline at end of file
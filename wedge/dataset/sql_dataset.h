@@ -1,29 +1,50 @@
 #pragma once
 
+#include <span>
 #include <string>
 
 #include "wedge/common/candle.h"
 #include "wedge/dataset/sql_iterator.h"
 
 struct sqlite3;
+struct sqlite3_stmt;
 
 namespace wedge {
 
+enum class InsertMode {
+  kInsert,
+  kUpsert,
+};
+
 class SqlDataset {
  public:
   explicit SqlDataset(const std::string& name);
 
+  SqlDataset(const SqlDataset&) = delete;
+  SqlDataset& operator=(const SqlDataset&) = delete;
+
   void insert(const Candle& candle);
+  void insert_batch(std::span<const Candle> candles,
+                    InsertMode mode = InsertMode::kInsert);
 
   SqlIterator iterator(std::optional<std::string> start_time = {},
                        std::optional<std::string> end_time = {});
+  SqlIterator iterator(int64_t start_time, int64_t end_time);
 
   int64_t get_max_start_time();
 
+  // Latest open_time in [begin, end), used to resume a partially downloaded
+  // time range.
+  std::optional<int64_t> get_max_open_time(int64_t begin, int64_t end);
+
   ~SqlDataset();
 
  private:
+  struct sqlite3_stmt* statement(InsertMode mode);
+
   struct sqlite3* db_;
+  struct sqlite3_stmt* insert_stmt_ = nullptr;
+  struct sqlite3_stmt* upsert_stmt_ = nullptr;
 };
 
 }  // namespace wedge
\ No newline at end of file
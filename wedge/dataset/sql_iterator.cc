@@ -2,31 +2,26 @@
 
 #include <sqlite3.h>
 
-#include <ctime>
-#include <iomanip>
 #include <limits>
-#include <sstream>
+
+#include "wedge/common/chrono.h"
 
 namespace wedge {
 
-static int64_t as_unix_timestamp(const std::string& time_str) {
-  std::tm tm = {};
-  std::istringstream ss(time_str);
-  ss >> std::get_time(&tm, "%Y-%m-%d");
-  return static_cast<int64_t>(std::mktime(&tm)) * 1000;
+static int64_t start_timestamp(const std::optional<std::string>& time_str) {
+  return time_str ? as_unix_timestamp(*time_str) : 0;
+}
+
+static int64_t end_timestamp(const std::optional<std::string>& time_str) {
+  return time_str ? as_unix_timestamp(*time_str)
+                  : std::numeric_limits<int64_t>::max();
 }
 
 SqlIterator::SqlIterator(sqlite3* db, std::optional<std::string> start_time,
-                         std::optional<std::string> end_time) {
-  int64_t start_timestamp = 0;
-  int64_t end_timestamp = std::numeric_limits<int64_t>::max();
-  if (start_time) {
-    start_timestamp = as_unix_timestamp(*start_time);
-  }
-  if (end_time) {
-    end_timestamp = as_unix_timestamp(*end_time);
-  }
+                         std::optional<std::string> end_time)
+    : SqlIterator(db, start_timestamp(start_time), end_timestamp(end_time)) {}
 
+SqlIterator::SqlIterator(sqlite3* db, int64_t start_time, int64_t end_time) {
   const char* sql = R"(
       SELECT open_time, close_time, open_price, high_price, low_price, close_price, volume,
              quote_volume, traders, taker_buy_base, taker_buy_quote 
@@ -34,8 +29,8 @@ SqlIterator::SqlIterator(sqlite3* db, std::optional<std::string> start_time,
       WHERE open_time >= ? AND open_time <= ?
       ORDER BY open_time ASC)";
   sqlite3_prepare_v2(db, sql, -1, &stmt_, nullptr);
-  sqlite3_bind_int64(stmt_, 1, start_timestamp);
-  sqlite3_bind_int64(stmt_, 2, end_timestamp);
+  sqlite3_bind_int64(stmt_, 1, start_time);
+  sqlite3_bind_int64(stmt_, 2, end_time);
 }
 
 SqlIterator::~SqlIterator() {
@@ -44,10 +39,13 @@ SqlIterator::~SqlIterator() {
   }
 }
 
-std::optional<Candle> SqlIterator::next() {
+bool SqlIterator::step(Candle& candle) {
+  // Stepping a finished statement would silently restart the query.
+  if (done_) {
+    return false;
+  }
   int rc = sqlite3_step(stmt_);
   if (rc == SQLITE_ROW) {
-    Candle candle;
     candle.open_time = sqlite3_column_int64(stmt_, 0);
     candle.close_time = sqlite3_column_int64(stmt_, 1);
     candle.open_price = sqlite3_column_double(stmt_, 2);
@@ -59,12 +57,29 @@ std::optional<Candle> SqlIterator::next() {
     candle.traders = sqlite3_column_int(stmt_, 8);
     candle.taker_buy_base = sqlite3_column_double(stmt_, 9);
     candle.taker_buy_quote = sqlite3_column_double(stmt_, 10);
-    return candle;
+    return true;
   } else if (rc == SQLITE_DONE) {
-    return std::nullopt;
+    done_ = true;
+    return false;
   } else {
     std::abort();
   }
 }
 
+std::optional<Candle> SqlIterator::next() {
+  Candle candle;
+  if (!step(candle)) {
+    return std::nullopt;
+  }
+  return candle;
+}
+
+size_t SqlIterator::next_batch(std::span<Candle> candles) {
+  size_t count = 0;
+  while (count < candles.size() && step(candles[count])) {
+    count++;
+  }
+  return count;
+}
+
 }  // namespace wedge
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <optional>
+#include <span>
 #include <string>
 
 #include "wedge/common/candle.h"
@@ -14,6 +15,8 @@ class SqlIterator {
  public:
   SqlIterator(struct sqlite3* db, std::optional<std::string> start_time,
               std::optional<std::string> end_time);
+  // Bounds are unix milliseconds, both inclusive.
+  SqlIterator(struct sqlite3* db, int64_t start_time, int64_t end_time);
 
   SqlIterator(const SqlIterator&) = delete;
   SqlIterator& operator=(const SqlIterator&) = delete;
@@ -22,8 +25,15 @@ class SqlIterator {
 
   std::optional<Candle> next();
 
+  // Fills the front of `candles` and returns how many were written, zero
+  // once the iterator is exhausted.
+  size_t next_batch(std::span<Candle> candles);
+
  private:
+  bool step(Candle& candle);
+
   struct sqlite3_stmt* stmt_;
+  bool done_ = false;
 };
 
 }  // namespace wedge
@@ -1,7 +1,9 @@
 
 target("wedge.dataset", function () 
   set_kind("static")
-  add_files("sql_dataset.cc", "sql_iterator.cc")
+  add_files("column_dataset.cc", "compressed_dataset.cc", "load_candles.cc",
+            "merge_iterator.cc", "rollup_builder.cc", "sql_dataset.cc",
+            "sql_iterator.cc")
   add_packages("sqlite3", { public = true })
 end)
 
@@ -9,4 +11,23 @@ target("wedge.download", function ()
   set_kind("binary")
   add_files("download.cc")
   add_deps("wedge.binance", "wedge.dataset")
+end)
+
+target("wedge.convert", function () 
+  set_kind("binary")
+  add_files("convert.cc")
+  add_deps("wedge.dataset")
+end)
+
+target("wedge.rollup", function () 
+  set_kind("binary")
+  add_files("rollup.cc")
+  add_deps("wedge.dataset")
+end)
+
+target("wedge.import", function () 
+  set_kind("binary")
+  add_files("import.cc", "kline_csv.cc", "zip_reader.cc")
+  add_deps("wedge.dataset")
+  add_packages("zlib")
 end)
\ No newline at end of file
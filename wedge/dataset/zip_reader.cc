@@ -0,0 +1,109 @@
+#include "wedge/dataset/zip_reader.h"
+
+#include <zlib.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace wedge {
+
+const uint32_t kEndOfCentralDirectory = 0x06054b50;
+const uint32_t kCentralDirectoryEntry = 0x02014b50;
+const uint32_t kLocalFileHeader = 0x04034b50;
+const uint16_t kStored = 0;
+const uint16_t kDeflated = 8;
+
+template <class T>
+static T load(const std::string& data, size_t offset) {
+  if (offset + sizeof(T) > data.size()) {
+    throw std::runtime_error("truncated zip archive");
+  }
+  T value;
+  std::memcpy(&value, data.data() + offset, sizeof(T));
+  return value;
+}
+
+static std::string inflate_raw(const char* data, size_t size,
+                               size_t uncompressed_size) {
+  std::string result(uncompressed_size, '\0');
+  z_stream stream{};
+  if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+    throw std::runtime_error("inflateInit2 failed");
+  }
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  stream.avail_in = static_cast<uInt>(size);
+  stream.next_out = reinterpret_cast<Bytef*>(result.data());
+  stream.avail_out = static_cast<uInt>(result.size());
+  int rc = inflate(&stream, Z_FINISH);
+  inflateEnd(&stream);
+  if (rc != Z_STREAM_END) {
+    throw std::runtime_error("corrupted zip entry");
+  }
+  return result;
+}
+
+std::vector<std::string> read_zip(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("cannot open " + path);
+  }
+  std::string data(std::istreambuf_iterator<char>(file), {});
+
+  // The end of central directory record is followed by a comment of at most
+  // 64KiB, search backwards for its signature.
+  size_t eocd = std::string::npos;
+  if (data.size() >= 22) {
+    size_t lowest = data.size() > 65557 ? data.size() - 65557 : 0;
+    for (size_t i = data.size() - 21; i-- > lowest;) {
+      if (load<uint32_t>(data, i) == kEndOfCentralDirectory) {
+        eocd = i;
+        break;
+      }
+    }
+  }
+  if (eocd == std::string::npos) {
+    throw std::runtime_error("not a zip archive " + path);
+  }
+
+  uint16_t entries = load<uint16_t>(data, eocd + 10);
+  size_t entry = load<uint32_t>(data, eocd + 16);
+  std::vector<std::string> result;
+  for (int i = 0; i < entries; i++) {
+    if (load<uint32_t>(data, entry) != kCentralDirectoryEntry) {
+      throw std::runtime_error("corrupted zip directory " + path);
+    }
+    uint16_t method = load<uint16_t>(data, entry + 10);
+    size_t compressed_size = load<uint32_t>(data, entry + 20);
+    size_t uncompressed_size = load<uint32_t>(data, entry + 24);
+    size_t name_size = load<uint16_t>(data, entry + 28);
+    size_t extra_size = load<uint16_t>(data, entry + 30);
+    size_t comment_size = load<uint16_t>(data, entry + 32);
+    size_t header = load<uint32_t>(data, entry + 42);
+    entry += 46 + name_size + extra_size + comment_size;
+
+    if (load<uint32_t>(data, header) != kLocalFileHeader) {
+      throw std::runtime_error("corrupted zip entry " + path);
+    }
+    size_t offset = header + 30 + load<uint16_t>(data, header + 26) +
+                    load<uint16_t>(data, header + 28);
+    if (offset + compressed_size > data.size()) {
+      throw std::runtime_error("truncated zip archive " + path);
+    }
+
+    const char* content = data.data() + offset;
+    if (method == kStored) {
+      result.emplace_back(content, compressed_size);
+    } else if (method == kDeflated) {
+      result.push_back(
+          inflate_raw(content, compressed_size, uncompressed_size));
+    } else {
+      throw std::runtime_error("unsupported zip compression " + path);
+    }
+  }
+  return result;
+}
+
+}  // namespace wedge
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace wedge {
+
+// Returns the contents of every file in a zip archive. Only stored and
+// deflated entries without zip64 extensions are supported, which covers the
+// Binance archives.
+std::vector<std::string> read_zip(const std::string& path);
+
+}  // namespace wedge
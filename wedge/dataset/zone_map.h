@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "wedge/common/candle.h"
+
+namespace wedge {
+
+inline constexpr size_t kZoneBlockSize = 4096;
+
+// Value ranges of one block of candles.
+struct Zone {
+  int64_t min_open_time;
+  int64_t max_open_time;
+  double min_low_price;
+  double max_high_price;
+  double min_volume;
+  double max_volume;
+
+  static Zone of(const Candle& candle) {
+    return Zone{
+        .min_open_time = candle.open_time,
+        .max_open_time = candle.open_time,
+        .min_low_price = candle.low_price,
+        .max_high_price = candle.high_price,
+        .min_volume = candle.volume,
+        .max_volume = candle.volume,
+    };
+  }
+
+  void extend(const Candle& candle) {
+    min_open_time = std::min(min_open_time, candle.open_time);
+    max_open_time = std::max(max_open_time, candle.open_time);
+    min_low_price = std::min(min_low_price, candle.low_price);
+    max_high_price = std::max(max_high_price, candle.high_price);
+    min_volume = std::min(min_volume, candle.volume);
+    max_volume = std::max(max_volume, candle.volume);
+  }
+};
+
+// Conjunction of range predicates. Blocks whose zone cannot satisfy it are
+// skipped without being read.
+struct CandleQuery {
+  int64_t start_time = 0;
+  int64_t end_time = std::numeric_limits<int64_t>::max();
+  std::optional<double> low_below;
+  std::optional<double> high_above;
+  std::optional<double> volume_above;
+
+  bool may_match(const Zone& zone) const {
+    return zone.max_open_time >= start_time &&
+           zone.min_open_time <= end_time &&
+           (!low_below || zone.min_low_price < *low_below) &&
+           (!high_above || zone.max_high_price > *high_above) &&
+           (!volume_above || zone.max_volume > *volume_above);
+  }
+
+  bool matches(const Candle& candle) const {
+    return candle.open_time >= start_time && candle.open_time <= end_time &&
+           (!low_below || candle.low_price < *low_below) &&
+           (!high_above || candle.high_price > *high_above) &&
+           (!volume_above || candle.volume > *volume_above);
+  }
+};
+
+// Index of the first block that may hold an open_time >= time.
+inline size_t seek_zone(std::span<const Zone> zones, int64_t time) {
+  auto iter = std::partition_point(
+      zones.begin(), zones.end(),
+      [time](const Zone& zone) { return zone.max_open_time < time; });
+  return iter - zones.begin();
+}
+
+}  // namespace wedge
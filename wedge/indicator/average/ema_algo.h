@@ -1,5 +1,7 @@
 #pragma once
 
+#include <nlohmann/json.hpp>
+
 namespace wedge {
 
 class ExponentialMovingAverageAlgo final {
@@ -18,6 +20,15 @@ class ExponentialMovingAverageAlgo final {
 
   double value() const { return value_; }
 
+  void to_json(nlohmann::json& json) const {
+    json = {{"value", value_}, {"has_value", has_value_}};
+  }
+
+  void from_json(const nlohmann::json& json) {
+    value_ = json["value"];
+    has_value_ = json["has_value"];
+  }
+
  private:
   double alpha_;
   double value_;
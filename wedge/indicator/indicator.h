@@ -1,5 +1,7 @@
 #pragma once
 
+#include <nlohmann/json.hpp>
+
 #include <algorithm>
 #include <memory>
 #include <utility>
@@ -15,6 +17,9 @@ class Indicator {
   virtual void update(const Candle& candle) = 0;
   virtual double value() const = 0;
   virtual int period() const = 0;
+  // Full internal state, so a checkpointed backtest resumes exactly.
+  virtual void to_json(nlohmann::json& json) const = 0;
+  virtual void from_json(const nlohmann::json& json) = 0;
 };
 
 class IndicatorContext {
@@ -48,6 +48,24 @@ class RelativeStrengthIndex final : public Indicator {
 
   int period() const override { return period_ * kCycleSize; }
 
+  void to_json(nlohmann::json& json) const override {
+    json["count"] = count_;
+    json["last_value"] = last_value_;
+    for (int i = 0; i < kCycleSize; i++) {
+      average_gain_[i].to_json(json["average_gain"][i]);
+      average_loss_[i].to_json(json["average_loss"][i]);
+    }
+  }
+
+  void from_json(const nlohmann::json& json) override {
+    count_ = json["count"];
+    last_value_ = json["last_value"].get<std::vector<double>>();
+    for (int i = 0; i < kCycleSize; i++) {
+      average_gain_[i].from_json(json["average_gain"][i]);
+      average_loss_[i].from_json(json["average_loss"][i]);
+    }
+  }
+
  private:
   int period_;
   int count_ = 0;
@@ -22,6 +22,18 @@ class Range final : public Indicator {
 
   int period() const override { return high_.size(); }
 
+  void to_json(nlohmann::json& json) const override {
+    json["count"] = count_;
+    json["high"] = high_;
+    json["low"] = low_;
+  }
+
+  void from_json(const nlohmann::json& json) override {
+    count_ = json["count"];
+    high_ = json["high"].get<std::vector<double>>();
+    low_ = json["low"].get<std::vector<double>>();
+  }
+
  private:
   template <class Perd>
   static double apply(const std::vector<double>& vector, Perd&& perd) {
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <nlohmann/json.hpp>
+
+#include <cstdint>
+#include <functional>
+
 #include "wedge/common/account.h"
 
 namespace wedge {
@@ -7,20 +12,36 @@ namespace wedge {
 class OrderIndex {
  public:
   OrderIndex() = default;
-  explicit OrderIndex(int index) : index_(index) {}
+  // Brokers that reuse indices bump the generation, so a handle to a filled
+  // or canceled order never matches the order that took over its slot.
+  explicit OrderIndex(int index, uint32_t generation = 0)
+      : index_(index), generation_(generation) {}
   int index() const { return index_; }
+  uint32_t generation() const { return generation_; }
 
   bool operator<(const OrderIndex& other) const {
-    return index_ < other.index_;
+    if (index_ != other.index_) {
+      return index_ < other.index_;
+    }
+    return generation_ < other.generation_;
   }
   bool operator==(const OrderIndex& other) const {
-    return index_ == other.index_;
+    return index_ == other.index_ && generation_ == other.generation_;
   }
 
  private:
   int index_;
+  uint32_t generation_ = 0;
 };
 
+inline void to_json(nlohmann::json& json, const OrderIndex& index) {
+  json = {index.index(), index.generation()};
+}
+
+inline void from_json(const nlohmann::json& json, OrderIndex& index) {
+  index = OrderIndex(json[0].get<int>(), json[1].get<uint32_t>());
+}
+
 class IBroker {
  public:
   virtual ~IBroker() = default;
@@ -34,14 +55,11 @@ class IBroker {
 
 }  // namespace wedge
 
-namespace std {
-template <typename T>
-class hash;
-}
-
 template <>
 struct std::hash<wedge::OrderIndex> {
   std::size_t operator()(const wedge::OrderIndex& order) const {
-    return std::hash<int>()(order.index());
+    uint64_t key = static_cast<uint64_t>(order.generation()) << 32 |
+                   static_cast<uint32_t>(order.index());
+    return std::hash<uint64_t>()(key);
   }
 };
\ No newline at end of file
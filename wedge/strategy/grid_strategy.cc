@@ -45,6 +45,25 @@ class RelativeStrengthIndex {
     return 100. - (100. / (1 + rs));
   }
 
+  void to_json(nlohmann::json& json) const {
+    json["sum_loss"] = sum_loss_;
+    json["sum_gain"] = sum_gain_;
+    json["last_price"] = last_price_ ? nlohmann::json(*last_price_) : nullptr;
+    json["gains"] = gains_;
+    json["losses"] = losses_;
+  }
+
+  void from_json(const nlohmann::json& json) {
+    sum_loss_ = json["sum_loss"];
+    sum_gain_ = json["sum_gain"];
+    last_price_ = std::nullopt;
+    if (!json["last_price"].is_null()) {
+      last_price_ = json["last_price"].get<double>();
+    }
+    gains_ = json["gains"].get<std::deque<double>>();
+    losses_ = json["losses"].get<std::deque<double>>();
+  }
+
  private:
   int period_;
   double sum_loss_;
@@ -57,8 +76,21 @@ class RelativeStrengthIndex {
 struct OrderInfo {
   OrderIndex index;
   double price;
+  NLOHMANN_DEFINE_TYPE_INTRUSIVE(OrderInfo, index, price)
 };
 
+static nlohmann::json optional_to_json(const std::optional<OrderInfo>& info) {
+  return info ? nlohmann::json(*info) : nlohmann::json(nullptr);
+}
+
+static std::optional<OrderInfo> optional_from_json(
+    const nlohmann::json& json) {
+  if (json.is_null()) {
+    return std::nullopt;
+  }
+  return json.get<OrderInfo>();
+}
+
 class GridStrategy : public IStrategy {
  public:
   GridStrategy() : baseline_price_(0) {}
@@ -67,12 +99,35 @@ class GridStrategy : public IStrategy {
     grid_count_ = json["grid_count"];
     grid_spacing_ = json["grid_spacing"];
 
+    if (json.contains("state")) {
+      const nlohmann::json& state = json["state"];
+      baseline_price_ = state["baseline_price"];
+      order_volume_ = state["order_volume"];
+      order_balance = state["order_balance"];
+      buy_order_ = optional_from_json(state["buy_order"]);
+      sell_order_ = optional_from_json(state["sell_order"]);
+      index_.from_json(state["rsi"]);
+      return;
+    }
+
     if (!json.contains("rsi_price")) return;
     for (double price : json["rsi_price"]) {
       index_.update(price);
     }
   }
 
+  void to_json(nlohmann::json& json) const override {
+    json["grid_count"] = grid_count_;
+    json["grid_spacing"] = grid_spacing_;
+    nlohmann::json& state = json["state"];
+    state["baseline_price"] = baseline_price_;
+    state["order_volume"] = order_volume_;
+    state["order_balance"] = order_balance;
+    state["buy_order"] = optional_to_json(buy_order_);
+    state["sell_order"] = optional_to_json(sell_order_);
+    index_.to_json(state["rsi"]);
+  }
+
   void update(const Candle& candle) override {
     index_.update(candle.close_price);
     auto value = index_.value();
@@ -184,7 +239,7 @@ class GridStrategy : public IStrategy {
 
   double baseline_price_;
   int grid_count_;
-  double order_volume_;
+  double order_volume_ = 0;
   double grid_spacing_;
 
   std::optional<OrderInfo> buy_order_;
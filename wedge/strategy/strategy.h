@@ -17,7 +17,9 @@ class IStrategy {
   virtual ~IStrategy() = default;
   virtual void update(const Candle& candle) = 0;
   virtual void on_order_filled(OrderIndex index) = 0;
+  // Reads the parameters, plus the "state" written by to_json if present.
   virtual void from_json(const nlohmann::json& josn) = 0;
+  virtual void to_json(nlohmann::json& json) const = 0;
   void set_broker(IBroker* broker) { broker_ = broker; }
   void set_logger(LoggerPtr logger) { logger_ = logger; }
 
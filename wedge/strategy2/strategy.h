@@ -5,7 +5,7 @@
 
 #include <cstdint>
 #include <optional>
-#include <vector>
+#include <span>
 
 #include "wedge/common/candle.h"
 #include "wedge/common/enums.h"
@@ -21,15 +21,18 @@ struct Order {
 
 struct OrderList {
   uint64_t order_list_id;
-  std::vector<Order> orders;
+  // Every order of the list, including the ones already closed.
+  std::span<const Order> orders;
 };
 
+// The spans view tables owned by the broker. They stay valid for the whole
+// callback; orders placed or canceled during it show up in the next event.
 struct ScheduleTaskEvent {
   double base;
   double quote;
   Candle current_candle;
-  std::vector<Order> open_orders;
-  std::vector<OrderList> open_order_lists;
+  std::span<const Order> open_orders;
+  std::span<const OrderList> open_order_lists;
 };
 
 class StrategyBase {
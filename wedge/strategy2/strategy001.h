@@ -2,7 +2,7 @@
 
 #include <algorithm>
 #include <memory>
-#include <vector>
+#include <span>
 
 #include "wedge/common/candle.h"
 #include "wedge/common/enums.h"
@@ -13,21 +13,31 @@
 
 namespace wedge {
 
-class Strategy001 final : public StrategyBase {
+// BrokerType is the broker the strategy runs against. Strategy001 works with
+// any Broker, BasicStrategy001<BacktestEngine> calls the engine without
+// virtual dispatch, see benchmark_strategy001.cc.
+template <class BrokerType = Broker>
+class BasicStrategy001 final : public StrategyBase {
  public:
   using StrategyBase::StrategyBase;
 
-  void to_json(nlohmann::json& json) override {}
+  void to_json(nlohmann::json& json) override {
+    json["k"] = k;
+    range->to_json(json["range"]);
+  }
 
   void from_json(const nlohmann::json& json) override {
     range = std::make_unique<Range>(24);
-    k = 0.1;
+    k = json.contains("k") ? json["k"].get<double>() : 0.1;
+    if (json.contains("range")) {
+      range->from_json(json["range"]);
+    }
   }
 
   void on_event(const ScheduleTaskEvent& event) override {
     for (const auto& list : event.open_order_lists) {
       if (is_new_order(list.orders)) {
-        broker_->execute(CancelOrderList{.order_list_id = list.order_list_id});
+        broker()->execute(CancelOrderList{.order_list_id = list.order_list_id});
       }
     }
 
@@ -37,7 +47,7 @@ class Strategy001 final : public StrategyBase {
     double open_price = candle.open_price;
     double limit_price = open_price - range->value() * k;
 
-    broker_->execute(NewOtocoOrderList {
+    broker()->execute(NewOtocoOrderList {
       .working = NewLimitOrder {
         .side = OrderSide::kBuy,
         .price = limit_price,
@@ -56,7 +66,7 @@ class Strategy001 final : public StrategyBase {
     });
   }
 
-  static bool is_new_order(const std::vector<Order>& orders) {
+  static bool is_new_order(std::span<const Order> orders) {
     auto is_filled = [](auto& order) {
       return order.status == OrderStatus::kFilled;
     };
@@ -65,6 +75,11 @@ class Strategy001 final : public StrategyBase {
 
   double k;
   std::unique_ptr<Indicator> range;
+
+ private:
+  BrokerType* broker() const { return static_cast<BrokerType*>(broker_); }
 };
 
+using Strategy001 = BasicStrategy001<>;
+
 }  // namespace wedge
\ No newline at end of file
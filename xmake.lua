@@ -2,7 +2,7 @@ add_rules("mode.debug", "mode.release")
 
 add_rules("plugin.compile_commands.autoupdate")
 
-add_requires("boost", "fmt", "nlohmann_json", "openssl", "sqlite3")
+add_requires("boost", "fmt", "nlohmann_json", "openssl", "sqlite3", "zlib")
 add_requires("spdlog", { configs = {fmt_external = true} })
 
 set_languages("cxx20")